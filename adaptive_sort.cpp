@@ -0,0 +1,47 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adaptive_sort.hpp"
+
+using namespace std;
+
+string to_string(SortStrategy strategy){
+    switch(strategy){
+    case SortStrategy::NONE: return "none";
+    case SortStrategy::MERGE: return "merge";
+    case SortStrategy::GROUPS: return "groups";
+    case SortStrategy::FULL: return "full";
+    }
+    return "unknown";
+}
+
+ostream& operator<<(ostream& out, SortStrategy strategy){
+    out << to_string(strategy);
+    return out;
+}
+
+SortStrategy choose_sort_strategy(const EdgeRuns& runs){
+    if(runs.m_num_runs <= 1){
+        return SortStrategy::NONE;
+    } else if(runs.m_num_runs <= EdgeRuns::s_max_runs){ // log2(runs) linear passes
+        return SortStrategy::MERGE;
+    } else if(runs.m_num_source_descents == 0){ // sort each group on its own
+        return SortStrategy::GROUPS;
+    } else {
+        return SortStrategy::FULL;
+    }
+}
@@ -0,0 +1,243 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "edge.hpp"
+#include "packed_edge.hpp"
+#include "parallel_sort.hpp"
+#include "tracer.hpp"
+#include "work_stealing_pool.hpp"
+
+/**
+ * The natural runs of the edge array, the maximal sequences of edges already sorted by source and destination. They
+ * are detected while the edges are appended, comparing each edge with the previous one, still in the cache, and
+ * determine the strategy of the sort.
+ */
+struct EdgeRuns {
+    static constexpr uint64_t s_max_runs = 64; // max number of runs whose boundaries are recorded, to merge them
+
+    uint64_t m_num_runs = 0; // number of natural runs
+    uint64_t m_num_source_descents = 0; // number of edges with a smaller source than the previous edge
+    std::vector<uint64_t> m_run_starts; // the position of the first edge of each run, only while m_num_runs <= s_max_runs
+
+    // record the edge appended at the given position, after `previous'
+    template<typename E>
+    void append(const E* previous, const E& edge, uint64_t position){
+        if(previous == nullptr){ // first edge
+            m_num_runs = 1;
+            m_run_starts.assign(1, 0);
+        } else if(EdgeOrder{}(edge, *previous)){ // the start of a new run
+            m_num_runs++;
+            if(m_num_runs <= s_max_runs){ m_run_starts.push_back(position); }
+            if(edge.m_source < previous->m_source){ m_num_source_descents++; }
+        }
+    }
+};
+
+/**
+ * How to sort the edges, given their natural runs
+ */
+enum class SortStrategy {
+    NONE, // the edges are already sorted
+    MERGE, // few runs, merged in a binary tree
+    GROUPS, // the edges are grouped by source, only the destinations of each group need to be sorted
+    FULL, // a full sort of the array
+};
+
+std::string to_string(SortStrategy strategy);
+std::ostream& operator<<(std::ostream& out, SortStrategy strategy);
+
+/**
+ * Pick the cheapest strategy applicable to the given runs
+ */
+SortStrategy choose_sort_strategy(const EdgeRuns& runs);
+
+/**
+ * Sort the edges by source and destination, in place, exploiting the natural runs of the array. With low_memory, the
+ * sort avoids the auxiliary arrays proportional to the number of edges, i.e. the buffers of the merges.
+ * Return the strategy executed.
+ */
+template<typename E>
+SortStrategy adaptive_sort(E* edges, uint64_t num_edges, const EdgeRuns& runs, uint64_t num_threads, bool low_memory);
+
+/*****************************************************************************
+ *                                                                           *
+ *  Implementation                                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+// merge [first, middle) and [middle, last) with a scratch buffer of the given capacity. When one of the two runs fits
+// in the buffer, it is moved aside and the runs are merged in a single pass. Otherwise the larger run is cut in half,
+// the matching position is searched in the other run and a rotation leaves two smaller merges, as in the merge without
+// buffer of std::inplace_merge. Equal edges retain their order, the left run first.
+template<typename E>
+void merge_bounded(E* first, E* middle, E* last, E* buffer, uint64_t capacity){
+    EdgeOrder order;
+    const uint64_t len1 = middle - first, len2 = last - middle;
+    if(len1 == 0 || len2 == 0) return;
+
+    if(len1 <= capacity){ // move the left run aside and merge forwards
+        E* buffer_end = std::move(first, middle, buffer);
+        E* left = buffer; E* right = middle; E* out = first;
+        while(left < buffer_end && right < last){
+            if(order(*right, *left)){ *out++ = std::move(*right++); } else { *out++ = std::move(*left++); }
+        }
+        std::move(left, buffer_end, out);
+    } else if(len2 <= capacity){ // move the right run aside and merge backwards
+        E* right = std::move(middle, last, buffer); E* left = middle; E* out = last;
+        while(right > buffer && left > first){
+            if(order(right[-1], left[-1])){ *--out = std::move(*--left); } else { *--out = std::move(*--right); }
+        }
+        std::move_backward(buffer, right, out);
+    } else {
+        E* cut1; E* cut2;
+        if(len1 > len2){
+            cut1 = first + len1 / 2;
+            cut2 = std::lower_bound(middle, last, *cut1, order);
+        } else {
+            cut2 = middle + len2 / 2;
+            cut1 = std::upper_bound(first, middle, *cut2, order);
+        }
+        E* split = std::rotate(cut1, middle, cut2);
+        merge_bounded(first, cut1, split, buffer, capacity);
+        merge_bounded(split, cut2, last, buffer, capacity);
+    }
+}
+
+// merge [first, middle) and [middle, last). A merge larger than min_split is split in two halves of the same size,
+// merged by independent tasks of the pool: the median of the output is located on the merge path with a binary
+// search (co-rank), then a rotation moves the edges of the first half, from both runs, before those of the second
+// half. Equal edges retain their order, the left run first, as in std::inplace_merge. With low_memory, each merge
+// uses a scratch buffer of a fixed size rather than one as large as its shorter run.
+template<typename E>
+void parallel_merge(E* first, E* middle, E* last, WorkStealingPool* pool, uint64_t min_split, bool low_memory){
+    const uint64_t len1 = middle - first, len2 = last - middle;
+    if(len1 == 0 || len2 == 0) return;
+    if(pool == nullptr || len1 + len2 <= min_split){
+        TraceSpan span { "sort", "merge" };
+        if(low_memory){
+            constexpr uint64_t buffer_capacity = (1ull << 16); // edges in the scratch buffer of each merge
+            const uint64_t capacity = std::min(buffer_capacity, std::min(len1, len2));
+            std::unique_ptr<E[]> buffer { new E[capacity] };
+            merge_bounded(first, middle, last, buffer.get(), capacity);
+        } else {
+            std::inplace_merge(first, middle, last, EdgeOrder{});
+        }
+        return;
+    }
+
+    // the first k edges of the output are the first i edges of the left run and the first k - i of the right run
+    EdgeOrder order;
+    const uint64_t k = (len1 + len2) / 2;
+    uint64_t lo = (k > len2) ? k - len2 : 0, hi = std::min(k, len1);
+    while(lo < hi){
+        uint64_t i = lo + (hi - lo) / 2;
+        if(!order(middle[k - i -1], first[i])){ lo = i +1; } else { hi = i; }
+    }
+    const uint64_t i = lo, j = k - lo;
+
+    { // left[0, i) right[0, j) left[i, len1) right[j, len2)
+        TraceSpan span { "sort", "rotate" };
+        std::rotate(first + i, middle, middle + j);
+    }
+    E* split = first + k;
+    pool->submit([=](){ parallel_merge(first, first + i, split, pool, min_split, low_memory); });
+    parallel_merge(split, split + (len1 - i), last, pool, min_split, low_memory);
+}
+
+// merge the runs pairwise, level by level. The merges of the same level run in parallel and, in the last levels, with
+// fewer merges than threads, each merge is also split across the pool
+template<typename E>
+void merge_runs(E* edges, uint64_t num_edges, std::vector<uint64_t> bounds, WorkStealingPool* pool, bool low_memory){
+    // the merges are split until there are about four tasks per thread in the whole level
+    const uint64_t min_split = (pool != nullptr) ? std::max<uint64_t>(1ull << 16, num_edges / (4 * pool->num_threads())) : num_edges;
+    bounds.push_back(num_edges); // the start of each run, followed by the end of the array
+    while(bounds.size() > 2){ // more than one run
+        std::vector<uint64_t> next;
+        for(uint64_t i = 0; i +1 < bounds.size(); i += 2){
+            next.push_back(bounds[i]);
+            if(i +2 < bounds.size()){
+                E* first = edges + bounds[i]; E* middle = edges + bounds[i +1]; E* last = edges + bounds[i +2];
+                auto merge = [=](){ parallel_merge(first, middle, last, pool, min_split, low_memory); };
+                if(pool != nullptr){ pool->submit(merge); } else { merge(); }
+            }
+        }
+        next.push_back(num_edges);
+        if(pool != nullptr){ pool->wait(); }
+        bounds = std::move(next);
+    }
+}
+
+// sort the destinations of each group of edges with the same source, the groups must already be sorted by source
+template<typename E>
+void sort_groups(E* edges, uint64_t num_edges, WorkStealingPool* pool){
+    constexpr uint64_t task_size = (1ull << 16); // edges in each task, rounded up to the end of the last group
+    auto sort_range = [edges](uint64_t start, uint64_t end){
+        TraceSpan span { "sort", "sort-groups" };
+        uint64_t group_start = start;
+        for(uint64_t i = start +1; i <= end; i++){
+            if(i == end || edges[i].m_source != edges[group_start].m_source){
+                if(i - group_start > 1){ std::sort(edges + group_start, edges + i, EdgeOrder{}); }
+                group_start = i;
+            }
+        }
+    };
+
+    uint64_t start = 0;
+    while(start < num_edges){
+        uint64_t end = std::min(num_edges, start + task_size);
+        while(end < num_edges && edges[end].m_source == edges[end -1].m_source){ end++; } // do not split a group
+        if(pool != nullptr){ pool->submit([sort_range, start, end](){ sort_range(start, end); }); } else { sort_range(start, end); }
+        start = end;
+    }
+    if(pool != nullptr){ pool->wait(); }
+}
+
+template<typename E>
+SortStrategy adaptive_sort(E* edges, uint64_t num_edges, const EdgeRuns& runs, uint64_t num_threads, bool low_memory){
+    SortStrategy strategy = choose_sort_strategy(runs);
+    std::unique_ptr<WorkStealingPool> pool;
+    if(num_threads > 1 && (strategy == SortStrategy::MERGE || strategy == SortStrategy::GROUPS)){
+        pool.reset(new WorkStealingPool(num_threads, "sort-worker"));
+    }
+
+    switch(strategy){
+    case SortStrategy::NONE:
+        break;
+    case SortStrategy::MERGE:
+        merge_runs(edges, num_edges, runs.m_run_starts, pool.get(), low_memory);
+        break;
+    case SortStrategy::GROUPS:
+        sort_groups(edges, num_edges, pool.get());
+        break;
+    case SortStrategy::FULL:
+        if(!sort_edges_packed(edges, num_edges, num_threads)){ // vertex IDs beyond 32 bits
+            parallel_sort(edges, edges + num_edges, EdgeOrder{}, num_threads);
+        }
+        break;
+    }
+
+    return strategy;
+}
@@ -0,0 +1,407 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "async_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+#include "lib/common/error.hpp"
+#include "bounded_queue.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+OutputOptions g_output_options;
+
+// alignment of the buffers, the offsets and the lengths for O_DIRECT
+constexpr uint64_t g_alignment = 4096;
+
+OutputOptions::Engine output_engine_from_string(const string& engine){
+    if(engine == "auto"){
+        return OutputOptions::Engine::AUTO;
+    } else if(engine == "uring" || engine == "io_uring"){
+        return OutputOptions::Engine::IO_URING;
+    } else if(engine == "thread" || engine == "pwrite"){
+        return OutputOptions::Engine::THREAD;
+    } else {
+        INVALID_ARGUMENT("Invalid output engine: `" << engine << "'. Expected: auto, uring or thread");
+    }
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  Backends                                                                 *
+ *                                                                           *
+ *****************************************************************************/
+
+class AsyncWriter::Backend {
+public:
+    virtual ~Backend() { }
+
+    // Start writing the given buffer at the given offset of the file
+    virtual void submit(uint32_t buffer_id, const char* data, uint64_t size, uint64_t offset) = 0;
+
+    // Wait for a write to complete, return the id of its buffer
+    virtual uint32_t wait() = 0;
+
+    // Name of the backend
+    virtual const char* name() const = 0;
+};
+
+namespace {
+
+// A write in flight
+struct Request {
+    uint32_t m_buffer_id;
+    const char* m_data;
+    uint64_t m_size;
+    uint64_t m_offset;
+};
+
+// Write the whole buffer with pwrite, retrying on partial writes. Return 0 on success, or the errno.
+int pwrite_fully(int fd, const char* data, uint64_t size, uint64_t offset){
+    while(size > 0){
+        ssize_t rc = ::pwrite(fd, data, size, offset);
+        if(rc < 0){
+            if(errno == EINTR) continue;
+            return errno;
+        }
+        data += rc; size -= rc; offset += rc;
+    }
+    return 0;
+}
+
+/**
+ * A background thread executing the writes with pwrite, in order
+ */
+class ThreadBackend : public AsyncWriter::Backend {
+    struct Completion {
+        uint32_t m_buffer_id;
+        int m_error; // errno, or 0 on success
+    };
+
+    const int m_fd;
+    BoundedQueue<Request> m_requests;
+    BoundedQueue<Completion> m_completions;
+    std::thread m_thread;
+
+    void main_thread(){
+        g_tracer.set_thread_name("io-writer");
+        Request request;
+        while(m_requests.pop(request)){
+            TraceSpan span { "write", "pwrite" };
+            int error = pwrite_fully(m_fd, request.m_data, request.m_size, request.m_offset);
+            m_completions.push(Completion{ request.m_buffer_id, error });
+        }
+    }
+
+public:
+    ThreadBackend(int fd, uint64_t queue_depth) : m_fd(fd), m_requests(queue_depth), m_completions(queue_depth) {
+        m_thread = std::thread(&ThreadBackend::main_thread, this);
+    }
+
+    ~ThreadBackend(){
+        m_requests.close();
+        m_thread.join();
+    }
+
+    void submit(uint32_t buffer_id, const char* data, uint64_t size, uint64_t offset) override {
+        m_requests.push(Request{ buffer_id, data, size, offset });
+    }
+
+    uint32_t wait() override {
+        Completion completion;
+        if(!m_completions.pop(completion)) ERROR("The writer thread terminated");
+        if(completion.m_error != 0) ERROR("Cannot write into the output file: " << strerror(completion.m_error));
+        return completion.m_buffer_id;
+    }
+
+    const char* name() const override {
+        return "pwrite";
+    }
+};
+
+/**
+ * Submit the writes through io_uring. The ring is set up with the raw system calls, without liburing.
+ */
+class UringBackend : public AsyncWriter::Backend {
+    const int m_fd; // file to write
+    int m_ring_fd = -1; // io_uring instance
+    void* m_sq_ptr = nullptr; size_t m_sq_size = 0; // mapping of the submission queue
+    void* m_cq_ptr = nullptr; size_t m_cq_size = 0; // mapping of the completion queue, it may coincide with the submission queue
+    io_uring_sqe* m_sqes = nullptr; size_t m_sqes_size = 0; // the submission entries
+    unsigned* m_sq_tail = nullptr; unsigned* m_sq_mask = nullptr; unsigned* m_sq_array = nullptr;
+    unsigned* m_cq_head = nullptr; unsigned* m_cq_tail = nullptr; unsigned* m_cq_mask = nullptr;
+    io_uring_cqe* m_cqes = nullptr;
+    std::vector<Request> m_in_flight; // indexed by buffer id, to resubmit the partial writes
+
+    void enqueue(const Request& request){
+        unsigned tail = *m_sq_tail; // only this thread updates the tail
+        unsigned index = tail & *m_sq_mask;
+        io_uring_sqe* sqe = m_sqes + index;
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = m_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(request.m_data);
+        sqe->len = request.m_size;
+        sqe->off = request.m_offset;
+        sqe->user_data = request.m_buffer_id;
+        m_sq_array[index] = index;
+        __atomic_store_n(m_sq_tail, tail +1, __ATOMIC_RELEASE);
+
+        int rc = 0;
+        do {
+            rc = syscall(__NR_io_uring_enter, m_ring_fd, 1, 0, 0, nullptr, 0);
+        } while(rc < 0 && errno == EINTR);
+        if(rc < 0) ERROR("io_uring_enter: " << strerror(errno));
+    }
+
+    // Whether the kernel supports IORING_OP_WRITE. The rings can be set up since Linux 5.1, but the opcode is only
+    // available since 5.6, as the probe: the older kernels fail the probe with EINVAL.
+    bool supports_write() const {
+        constexpr unsigned num_ops = 256;
+        std::unique_ptr<io_uring_probe, decltype(&free)> probe { static_cast<io_uring_probe*>(calloc(1, sizeof(io_uring_probe) + num_ops * sizeof(io_uring_probe_op))), &free };
+        if(!probe) throw std::bad_alloc();
+        int rc = syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_PROBE, probe.get(), num_ops);
+        if(rc < 0) return false;
+        return probe->last_op >= IORING_OP_WRITE && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    }
+
+public:
+    UringBackend(int fd, uint64_t queue_depth) : m_fd(fd) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        m_ring_fd = syscall(__NR_io_uring_setup, static_cast<unsigned>(queue_depth), &params);
+        if(m_ring_fd < 0) ERROR("io_uring_setup: " << strerror(errno));
+        if(!supports_write()){ release(); ERROR("io_uring does not support IORING_OP_WRITE, it requires Linux 5.6"); }
+
+        m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if(single_mmap){ m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size); }
+        m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+        if(m_sq_ptr == MAP_FAILED){ m_sq_ptr = nullptr; release(); ERROR("mmap io_uring: " << strerror(errno)); }
+        if(single_mmap){
+            m_cq_ptr = m_sq_ptr;
+        } else {
+            m_cq_ptr = mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+            if(m_cq_ptr == MAP_FAILED){ m_cq_ptr = nullptr; release(); ERROR("mmap io_uring: " << strerror(errno)); }
+        }
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = reinterpret_cast<io_uring_sqe*>(mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES));
+        if(m_sqes == MAP_FAILED){ m_sqes = nullptr; release(); ERROR("mmap io_uring: " << strerror(errno)); }
+
+        char* sq = reinterpret_cast<char*>(m_sq_ptr);
+        m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = reinterpret_cast<char*>(m_cq_ptr);
+        m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        m_in_flight.resize(queue_depth +1);
+    }
+
+    ~UringBackend(){
+        release();
+    }
+
+    void release(){
+        if(m_sqes != nullptr){ munmap(m_sqes, m_sqes_size); m_sqes = nullptr; }
+        if(m_cq_ptr != nullptr && m_cq_ptr != m_sq_ptr){ munmap(m_cq_ptr, m_cq_size); }
+        m_cq_ptr = nullptr;
+        if(m_sq_ptr != nullptr){ munmap(m_sq_ptr, m_sq_size); m_sq_ptr = nullptr; }
+        if(m_ring_fd >= 0){ ::close(m_ring_fd); m_ring_fd = -1; }
+    }
+
+    void submit(uint32_t buffer_id, const char* data, uint64_t size, uint64_t offset) override {
+        if(buffer_id >= m_in_flight.size()) m_in_flight.resize(buffer_id +1);
+        m_in_flight[buffer_id] = Request{ buffer_id, data, size, offset };
+        enqueue(m_in_flight[buffer_id]);
+    }
+
+    uint32_t wait() override {
+        while(true){
+            unsigned head = *m_cq_head;
+            if(head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)){ // empty, wait for a completion
+                int rc = syscall(__NR_io_uring_enter, m_ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if(rc < 0 && errno != EINTR) ERROR("io_uring_enter: " << strerror(errno));
+                continue;
+            }
+
+            io_uring_cqe cqe = m_cqes[head & *m_cq_mask];
+            __atomic_store_n(m_cq_head, head +1, __ATOMIC_RELEASE);
+
+            Request& request = m_in_flight[cqe.user_data];
+            if(cqe.res < 0) ERROR("Cannot write into the output file: " << strerror(-cqe.res));
+            if(static_cast<uint64_t>(cqe.res) < request.m_size){ // partial write, submit the remainder
+                request.m_data += cqe.res; request.m_size -= cqe.res; request.m_offset += cqe.res;
+                enqueue(request);
+                continue;
+            }
+            return request.m_buffer_id;
+        }
+    }
+
+    const char* name() const override {
+        return "io_uring";
+    }
+};
+
+} // anonymous namespace
+
+/*****************************************************************************
+ *                                                                           *
+ *  AsyncWriter                                                              *
+ *                                                                           *
+ *****************************************************************************/
+
+AsyncWriter::AsyncWriter(const string& path) : AsyncWriter(path, g_output_options) { }
+
+AsyncWriter::AsyncWriter(const string& path, const OutputOptions& options) : m_path(path),
+        m_buffer_size(std::max(g_alignment, (options.m_buffer_size + g_alignment -1) / g_alignment * g_alignment)) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if(options.m_direct_io){
+        m_fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        if(m_fd >= 0){
+            m_direct_io = true;
+        } else if(errno == EINVAL){ // O_DIRECT not supported by the file system, e.g. tmpfs
+            static once_flag warning;
+            call_once(warning, [](){ cout << "[AsyncWriter] Warning, O_DIRECT is not supported by the file system, using the page cache" << endl; });
+        }
+    }
+    if(m_fd < 0){ m_fd = ::open(path.c_str(), flags, 0644); }
+    if(m_fd < 0) ERROR("Cannot create the file " << path << ": " << strerror(errno));
+
+    uint64_t queue_depth = std::max<uint64_t>(1, options.m_queue_depth);
+    try {
+        if(options.m_engine != OutputOptions::Engine::THREAD){
+            try {
+                m_backend.reset(new UringBackend(m_fd, queue_depth));
+            } catch(common::Error& e){
+                if(options.m_engine == OutputOptions::Engine::IO_URING) throw; // explicitly requested
+                static once_flag warning;
+                call_once(warning, [&](){ cout << "[AsyncWriter] Warning, io_uring not available, using a background thread: " << e.what() << endl; });
+            }
+        }
+        if(!m_backend){ m_backend.reset(new ThreadBackend(m_fd, queue_depth)); }
+        m_engine = m_backend->name();
+
+        // one buffer being filled + the buffers in flight
+        for(uint64_t i = 0; i <= queue_depth; i++){
+            void* buffer = aligned_alloc(g_alignment, m_buffer_size);
+            if(buffer == nullptr) throw std::bad_alloc();
+            m_buffers.push_back(reinterpret_cast<char*>(buffer));
+            if(i > 0){ m_free_buffers.push_back(i); }
+        }
+    } catch(...){
+        m_backend.reset();
+        for(char* buffer : m_buffers){ free(buffer); }
+        ::close(m_fd);
+        ::unlink(path.c_str());
+        throw;
+    }
+}
+
+AsyncWriter::~AsyncWriter(){
+    if(!m_closed){
+        try {
+            while(m_num_in_flight > 0){ wait_one(); }
+        } catch(...){ /* ignore */ }
+        m_backend.reset();
+        ::close(m_fd);
+        ::unlink(m_path.c_str()); // the file is incomplete
+    }
+    for(char* buffer : m_buffers){ free(buffer); }
+}
+
+void AsyncWriter::write(const char* data, uint64_t size){
+    while(size > 0){
+        uint64_t count = std::min(size, available());
+        memcpy(this->data(), data, count);
+        advance(count);
+        data += count; size -= count;
+    }
+}
+
+void AsyncWriter::write(const string& data){
+    write(data.data(), data.size());
+}
+
+void AsyncWriter::advance(uint64_t num_bytes){
+    assert(num_bytes <= available() && "Overflow");
+    m_current_size += num_bytes;
+    if(m_current_size == m_buffer_size){ flush_buffer(m_buffer_size); }
+}
+
+void AsyncWriter::flush_buffer(uint64_t num_bytes){
+    if(m_free_buffers.empty()){ wait_one(); } // all buffers are in flight
+    m_backend->submit(m_current, m_buffers[m_current], num_bytes, m_file_offset);
+    m_num_in_flight++;
+    m_file_offset += m_current_size;
+    m_current = m_free_buffers.back();
+    m_free_buffers.pop_back();
+    m_current_size = 0;
+}
+
+void AsyncWriter::wait_one(){
+    TraceSpan span { "write", "wait-io" };
+    uint32_t buffer_id = m_backend->wait();
+    m_free_buffers.push_back(buffer_id);
+    m_num_in_flight--;
+}
+
+void AsyncWriter::close(){
+    if(m_closed) return;
+
+    const uint64_t file_size = bytes_written();
+    if(m_current_size > 0){
+        uint64_t num_bytes = m_current_size;
+        if(m_direct_io){ // pad to the alignment, the file is truncated afterwards
+            num_bytes = (num_bytes + g_alignment -1) / g_alignment * g_alignment;
+            memset(m_buffers[m_current] + m_current_size, 0, num_bytes - m_current_size);
+        }
+        flush_buffer(num_bytes);
+    }
+    while(m_num_in_flight > 0){ wait_one(); }
+    m_backend.reset();
+    m_closed = true; // if the writes failed, the destructor removes the file
+
+    TraceSpan span { "write", "fsync" };
+    int rc = 0;
+    if(m_direct_io && ftruncate(m_fd, file_size) != 0){ rc = errno; }
+    if(rc == 0 && fsync(m_fd) != 0){ rc = errno; }
+    if(::close(m_fd) != 0 && rc == 0){ rc = errno; }
+    if(rc != 0){
+        ::unlink(m_path.c_str()); // the file is incomplete
+        ERROR("Cannot write the file " << m_path << ": " << strerror(rc));
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Settings for the output files
+ */
+struct OutputOptions {
+    // How to submit the writes to the kernel
+    enum class Engine {
+        AUTO, // io_uring if the kernel supports IORING_OP_WRITE (Linux 5.6+), otherwise THREAD
+        IO_URING, // io_uring
+        THREAD, // a background thread invoking pwrite
+    };
+
+    Engine m_engine = Engine::AUTO;
+    uint64_t m_buffer_size = (1ull << 23); // size of each buffer, in bytes, 8 MB
+    uint64_t m_queue_depth = 4; // max number of writes in flight
+    bool m_direct_io = false; // whether to bypass the page cache, with O_DIRECT
+};
+
+/**
+ * The settings for all output files of the program
+ */
+extern OutputOptions g_output_options;
+
+/**
+ * Parse the name of an output engine: auto, uring or thread
+ */
+OutputOptions::Engine output_engine_from_string(const std::string& engine);
+
+/**
+ * Writer of a sequential output file, with the writes executed asynchronously, in the background. The producer fills
+ * a buffer, which is submitted to the kernel as soon as it is full, and continues with the next buffer, while up to
+ * `queue depth' writes are in flight. The producer waits only when all buffers are in flight. The buffers are aligned
+ * to 4 KB, as required by O_DIRECT. The data is flushed to the disk, with fsync, only at the end, by close().
+ *
+ * The producer can either copy the data with write(), or fill the buffer directly, e.g. as the output of zlib, with
+ * data() / available() / advance().
+ */
+class AsyncWriter {
+public:
+    class Backend; // io_uring or thread + pwrite
+
+private:
+    const std::string m_path; // path to the output file
+    int m_fd = -1; // file descriptor
+    bool m_direct_io = false; // whether the file has been opened with O_DIRECT
+    std::unique_ptr<Backend> m_backend; // execute the writes
+    const char* m_engine = ""; // name of the backend
+    const uint64_t m_buffer_size; // capacity of each buffer
+    std::vector<char*> m_buffers; // all buffers
+    std::vector<uint32_t> m_free_buffers; // ids of the buffers not in flight
+    uint32_t m_current = 0; // id of the buffer being filled
+    uint64_t m_current_size = 0; // bytes already filled in the current buffer
+    uint64_t m_num_in_flight = 0; // number of writes in flight
+    uint64_t m_file_offset = 0; // offset in the file for the next write
+    bool m_closed = false; // whether close() has already been invoked
+
+    // Submit the current buffer to the backend and acquire the next one
+    void flush_buffer(uint64_t num_bytes);
+
+    // Wait for one write to complete and return its buffer to the free list
+    void wait_one();
+
+public:
+    /**
+     * Create the file at the given path, with the global settings g_output_options
+     */
+    AsyncWriter(const std::string& path);
+
+    /**
+     * Create the file at the given path, with the given settings
+     */
+    AsyncWriter(const std::string& path, const OutputOptions& options);
+
+    /**
+     * If the file has not been closed, e.g. the producer failed or has been cancelled, wait for the writes in flight,
+     * close the file and remove it, rather than leaving a truncated output. Errors are ignored, use close() to check
+     * whether the file has been stored successfully.
+     */
+    ~AsyncWriter();
+
+    /**
+     * Append the given data to the file
+     */
+    void write(const char* data, uint64_t size);
+    void write(const std::string& data);
+
+    /**
+     * The current position in the buffer, for up to available() bytes
+     */
+    char* data() { return m_buffers[m_current] + m_current_size; }
+
+    /**
+     * The remaining space in the current buffer, always greater than zero
+     */
+    uint64_t available() const { return m_buffer_size - m_current_size; }
+
+    /**
+     * Mark the first `num_bytes' at data() as filled
+     */
+    void advance(uint64_t num_bytes);
+
+    /**
+     * Write the remaining data, wait for all writes to complete, sync the file to the disk and close it. If any of
+     * these steps fails, the file is removed.
+     */
+    void close();
+
+    /**
+     * Total number of bytes appended to the file
+     */
+    uint64_t bytes_written() const { return m_file_offset + m_current_size; }
+
+    /**
+     * Name of the backend in use, e.g. io_uring or pwrite
+     */
+    const char* engine() const { return m_engine; }
+};
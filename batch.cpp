@@ -0,0 +1,261 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "batch.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "lib/common/error.hpp"
+#include "lib/common/filesystem.hpp"
+#include "edge.hpp"
+#include "graphalytics_reader.hpp"
+#include "pipeline.hpp"
+#include "report.hpp"
+
+using namespace std;
+
+namespace {
+
+// A graph to convert
+struct Job {
+    string m_name; // name of the input graph, without the extension .properties
+    string m_path_input; // path to the input property file
+    string m_path_output; // path to the output property file
+    string m_path_log; // where to store the output of the conversion
+    uint64_t m_num_edges = 0; // meta.edges
+    uint64_t m_input_bytes = 0; // size of the input edge file
+    uint64_t m_memory = 0; // estimated memory footprint of the conversion, in bytes
+};
+
+// Outcome of a conversion
+struct Result {
+    bool m_success = false;
+    double m_seconds = 0; // wall clock time
+    uint64_t m_max_rss = 0; // peak resident set size of the child process, in bytes
+};
+
+// Estimate the memory required to convert the graph: the edge list, the dictionary of the vertices and the buffers
+uint64_t estimate_memory(const GraphalyticsReader& reader, WeightType weight_type){
+    uint64_t num_vertices = stoull(reader.get_property("meta.vertices"));
+    uint64_t num_edges = stoull(reader.get_property("meta.edges"));
+    uint64_t edge_size = sizeof(Edge);
+    if(reader.is_weighted()){ edge_size = is_compact(weight_type) ? sizeof(CompactWeightedEdge) : sizeof(WeightedEdge); }
+    constexpr uint64_t dictionary_entry = 48; // node of the hash map (key, value, next, padding of malloc) + bucket
+    constexpr uint64_t overhead = (1ull << 26); // batches, I/O buffers, zlib, 64 MB
+    return num_edges * edge_size + num_vertices * dictionary_entry + overhead;
+}
+
+// Execute the program at the given path in a child process, redirecting its output to the file `path_log'
+Result execute(const string& path_executable, const vector<string>& arguments, const string& path_log){
+    vector<char*> argv;
+    argv.push_back(const_cast<char*>(path_executable.c_str()));
+    for(auto& arg : arguments){ argv.push_back(const_cast<char*>(arg.c_str())); }
+    argv.push_back(nullptr);
+
+    // open the log before forking, the child must only invoke async-signal-safe functions
+    int fd_log = open(path_log.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd_log < 0) ERROR("Cannot create the file " << path_log << ": " << strerror(errno));
+
+    auto t0 = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if(pid < 0){ ::close(fd_log); ERROR("fork: " << strerror(errno)); }
+    if(pid == 0){ // child
+        dup2(fd_log, STDOUT_FILENO);
+        dup2(fd_log, STDERR_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127); // only reached on error
+    }
+    ::close(fd_log);
+
+    int status = 0;
+    struct rusage usage;
+    pid_t rc = 0;
+    do { rc = wait4(pid, &status, 0, &usage); } while(rc < 0 && errno == EINTR);
+    if(rc < 0) ERROR("wait4: " << strerror(errno));
+    Result result;
+    result.m_success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.m_seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    result.m_max_rss = static_cast<uint64_t>(usage.ru_maxrss) * 1024; // KB
+    return result;
+}
+
+// Path to the executable of this process, to convert each graph in a child process
+string path_self(){
+    char buffer[4096];
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) -1);
+    if(length < 0) ERROR("Cannot resolve the path of the executable: " << strerror(errno));
+    buffer[length] = '\0';
+    return string(buffer);
+}
+
+/**
+ * Pick the jobs, from the largest to the smallest, keeping the total estimated memory of the jobs in execution within
+ * the budget. A job larger than the whole budget is executed alone.
+ */
+class Scheduler {
+    mutex m_mutex;
+    condition_variable m_condvar;
+    vector<Job> m_pending; // sorted by the number of edges, in decreasing order
+    const uint64_t m_memory_budget;
+    uint64_t m_memory_used = 0; // estimated memory of the jobs in execution
+    uint64_t m_num_running = 0; // number of jobs in execution
+
+public:
+    Scheduler(vector<Job> jobs, uint64_t memory_budget) : m_pending(move(jobs)), m_memory_budget(memory_budget) {
+        stable_sort(begin(m_pending), end(m_pending), [](const Job& j1, const Job& j2){ return j1.m_num_edges > j2.m_num_edges; });
+    }
+
+    // Wait for the next job that fits in the memory budget. Return false when there are no more jobs
+    bool acquire(Job& out_job){
+        unique_lock<mutex> lock(m_mutex);
+        while(true){
+            if(m_pending.empty()) return false;
+            auto it = find_if(begin(m_pending), end(m_pending), [&](const Job& job){ return m_memory_used + job.m_memory <= m_memory_budget; });
+            if(it == end(m_pending) && m_num_running == 0){ it = begin(m_pending); } // too large for the budget, run it alone
+            if(it != end(m_pending)){
+                out_job = move(*it);
+                m_pending.erase(it);
+                m_memory_used += out_job.m_memory;
+                m_num_running++;
+                return true;
+            }
+            m_condvar.wait(lock);
+        }
+    }
+
+    // Release the memory of a completed job
+    void release(const Job& job){
+        unique_lock<mutex> lock(m_mutex);
+        m_memory_used -= job.m_memory;
+        m_num_running--;
+        m_condvar.notify_all();
+    }
+};
+
+} // anonymous namespace
+
+uint64_t default_memory_budget(){
+    uint64_t num_pages = sysconf(_SC_PHYS_PAGES);
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    return num_pages * page_size / 10 * 8;
+}
+
+uint64_t run_batch(const BatchSettings& settings){
+    if(!filesystem::is_directory(settings.m_input_directory)) INVALID_ARGUMENT("The input directory does not exist: `" << settings.m_input_directory << "'");
+    filesystem::create_directories(settings.m_output_directory);
+    const string path_executable = path_self();
+
+    // the graphs to convert
+    vector<string> paths;
+    for(auto& entry : filesystem::directory_iterator(settings.m_input_directory)){
+        if(entry.is_regular_file() && entry.path().extension() == ".properties"){ paths.push_back(entry.path().string()); }
+    }
+    sort(begin(paths), end(paths));
+
+    vector<Job> jobs;
+    for(auto& path : paths){
+        Job job;
+        job.m_name = filesystem::path(path).stem().string();
+        job.m_path_input = path;
+        job.m_path_output = settings.m_output_directory + "/" + job.m_name + "-dense.properties";
+        job.m_path_log = settings.m_output_directory + "/" + job.m_name + "-dense.log";
+        if(common::filesystem::file_exists(job.m_path_output)){
+            LOG("The file " << job.m_path_output << " already exists, skipped");
+            continue;
+        }
+
+        try {
+            GraphalyticsReader reader { path };
+            job.m_num_edges = stoull(reader.get_property("meta.edges"));
+            job.m_input_bytes = file_size(reader.get_path_edge_list());
+            job.m_memory = estimate_memory(reader, settings.m_weight_type);
+        } catch(common::Error& e){
+            LOG("Cannot read the properties of " << path << ", skipped: " << e.what());
+            continue;
+        } catch(std::logic_error& e){ // stoull, meta.edges or meta.vertices missing or invalid
+            LOG("Cannot read the properties of " << path << ", skipped: meta.vertices or meta.edges missing or invalid");
+            continue;
+        }
+        jobs.push_back(move(job));
+    }
+
+    const uint64_t num_jobs = jobs.size();
+    const uint64_t num_workers = max<uint64_t>(1, min(settings.m_num_jobs, num_jobs));
+    LOG("Graphs to convert: " << num_jobs << ", workers: " << num_workers << ", memory budget: " << to_string_bytes(settings.m_memory_budget));
+
+    Scheduler scheduler { move(jobs), settings.m_memory_budget };
+    mutex mutex_stats;
+    uint64_t num_completed = 0, num_failures = 0, total_edges = 0, total_bytes = 0;
+    common::Timer timer; timer.start();
+
+    auto worker = [&](){
+        Job job;
+        while(scheduler.acquire(job)){
+            vector<string> arguments = settings.m_arguments;
+            arguments.push_back(job.m_path_input);
+            arguments.push_back(job.m_path_output);
+
+            Result result;
+            try {
+                result = execute(path_executable, arguments, job.m_path_log);
+            } catch(common::Error& e){
+                LOG("[" << job.m_name << "] " << e.what());
+            }
+            scheduler.release(job);
+
+            unique_lock<mutex> lock(mutex_stats);
+            num_completed++;
+            if(result.m_success){
+                total_edges += job.m_num_edges;
+                total_bytes += job.m_input_bytes;
+                LOG("[" << num_completed << "/" << num_jobs << "] " << job.m_name << ": " << job.m_num_edges << " edges converted in " <<
+                        fixed << setprecision(2) << result.m_seconds << " seconds, peak memory: " << to_string_bytes(result.m_max_rss) <<
+                        " (estimated: " << to_string_bytes(job.m_memory) << ")");
+            } else {
+                num_failures++;
+                LOG("[" << num_completed << "/" << num_jobs << "] " << job.m_name << ": conversion failed, see " << job.m_path_log);
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for(uint64_t i = 0; i < num_workers; i++){ workers.emplace_back(worker); }
+    for(auto& t : workers){ t.join(); }
+    timer.stop();
+
+    double seconds = max(timer.microseconds() / 1000000.0, 1e-6);
+    LOG("Converted " << (num_jobs - num_failures) << " graphs out of " << num_jobs << " in " << timer << ", " << total_edges << " edges, " <<
+            to_string_bytes(total_bytes) << " of input, throughput: " << fixed << setprecision(0) << (total_edges / seconds) << " edges/sec, " <<
+            to_string_bytes(total_bytes / seconds) << "/sec");
+    if(num_failures > 0){ LOG("Failed conversions: " << num_failures); }
+
+    return num_failures;
+}
@@ -0,0 +1,52 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "weight.hpp"
+
+/**
+ * Settings of the batch mode
+ */
+struct BatchSettings {
+    std::string m_input_directory; // the directory with the graphs to convert, in the Graphalytics format
+    std::string m_output_directory; // where to store the converted graphs, as <name>-dense.properties
+    uint64_t m_num_jobs = 1; // max number of conversions executed concurrently
+    uint64_t m_memory_budget = 0; // max memory, in bytes, of the conversions executed concurrently
+    WeightType m_weight_type = WeightType::FLOAT64; // to estimate the memory footprint of the weighted graphs
+    std::vector<std::string> m_arguments; // the options forwarded to each conversion, e.g. --compress
+};
+
+/**
+ * Convert all graphs (*.properties) in the input directory. The conversions are executed by a pool of `num_jobs'
+ * workers, each converting one graph at the time in a child process, so that the graphs are isolated from each other.
+ * The graphs are scheduled from the largest to the smallest, by their number of edges (meta.edges), as long as their
+ * estimated memory footprint fits in the remaining memory budget. The graphs whose output already exists are skipped.
+ * The output of each conversion is saved in <name>-dense.log, in the output directory.
+ *
+ * @return the number of conversions that failed
+ */
+uint64_t run_batch(const BatchSettings& settings);
+
+/**
+ * The default memory budget of the batch mode: 80% of the physical memory of the machine
+ */
+uint64_t default_memory_budget();
@@ -0,0 +1,138 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lib/common/error.hpp"
+#include "lib/common/filesystem.hpp"
+#include "lib/common/timer.hpp"
+#include "rmat_generator.hpp"
+
+using namespace std;
+
+/*****************************************************************************
+ *                                                                           *
+ *  CSV                                                                      *
+ *                                                                           *
+ *****************************************************************************/
+
+CsvWriter::CsvWriter(const string& path){
+    struct stat st;
+    bool is_new = stat(path.c_str(), &st) != 0 || st.st_size == 0;
+    m_out.open(path, ios::out | ios::app);
+    if(!m_out.good()) ERROR("Cannot open the file `" << path << "'");
+    if(is_new){
+        m_out << "suite,benchmark,variant,scale,edges,threads,seconds,edges_per_second,bytes,mb_per_second,max_rss" << endl;
+    }
+}
+
+void CsvWriter::write(const Measurement& m){
+    double edges_per_second = m.m_seconds > 0 ? m.m_num_edges / m.m_seconds : 0;
+    double mb_per_second = m.m_seconds > 0 ? m.m_bytes / m.m_seconds / (1ull << 20) : 0;
+    m_out << m.m_suite << "," << m.m_benchmark << "," << m.m_variant << "," << m.m_scale << "," << m.m_num_edges << ","
+          << m.m_num_threads << "," << m.m_seconds << "," << edges_per_second << "," << m.m_bytes << "," << mb_per_second << ","
+          << m.m_max_rss << endl;
+
+    // progress
+    cout << "[" << m.m_suite << "] " << m.m_benchmark << " (" << m.m_variant << "): " << m.m_seconds << " secs, "
+         << edges_per_second << " edges/sec" << endl;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  Utilities                                                                *
+ *                                                                           *
+ *****************************************************************************/
+
+double run_in_child_process(void (*callback)(void* state, double* out_result), void* state){
+    int fd[2];
+    if(pipe(fd) != 0) ERROR("pipe: " << strerror(errno));
+    cout.flush();
+    pid_t pid = fork();
+    if(pid < 0) ERROR("fork: " << strerror(errno));
+    if(pid == 0){ // child
+        ::close(fd[0]);
+        double result = 0;
+        try {
+            callback(state, &result);
+        } catch(common::Error& e){
+            cerr << e << endl;
+            _exit(1);
+        }
+        cout.flush();
+        if(write(fd[1], &result, sizeof(result)) != sizeof(result)) _exit(1);
+        _exit(0);
+    }
+
+    ::close(fd[1]);
+    double result = 0;
+    ssize_t bytes_read = read(fd[0], &result, sizeof(result));
+    ::close(fd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if(bytes_read != sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ERROR("The measurement failed in the child process");
+    return result;
+}
+
+vector<uint64_t> parse_list(const string& value){
+    vector<uint64_t> result;
+    stringstream ss { value };
+    string item;
+    while(getline(ss, item, ',')){
+        if(item.empty()) continue;
+        result.push_back(stoull(item));
+    }
+    return result;
+}
+
+string prepare_graph(const BenchmarkSettings& settings, uint64_t scale){
+    stringstream ss;
+    ss << "rmat-" << scale << "-" << settings.m_edge_factor << (settings.m_directed ? "-d" : "-u") << (settings.m_weighted ? "w" : "") << "-" << settings.m_seed;
+    string path_prefix = settings.m_directory + "/" + ss.str();
+    string path_properties = path_prefix + ".properties";
+    if(common::filesystem::file_exists(path_properties)) return path_properties;
+
+    std::filesystem::create_directories(settings.m_directory);
+    cout << "Generating the graph " << path_properties << " ..." << endl;
+    common::Timer timer; timer.start();
+    RmatGenerator generator { scale, settings.m_edge_factor, settings.m_seed };
+    generator.set_directed(settings.m_directed);
+    generator.set_weighted(settings.m_weighted);
+    generator.save(path_prefix);
+    timer.stop();
+    cout << "Graph generated in " << timer << endl;
+
+    return path_properties;
+}
+
+void run_generate(const BenchmarkSettings& settings){
+    prepare_graph(settings, settings.m_scale);
+    for(uint64_t scale : settings.m_scales){
+        prepare_graph(settings, scale);
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "report.hpp" // file_size
+
+/**
+ * Settings shared by all benchmarks
+ */
+struct BenchmarkSettings {
+    std::string m_directory; // working directory, where to store the generated graphs and the outputs
+    uint64_t m_scale = 18; // log2 of the number of vertices of the generated graph, micro benchmarks
+    std::vector<uint64_t> m_scales; // log2 of the number of vertices of the generated graph, end-to-end sweep
+    uint64_t m_edge_factor = 16; // average number of edges per vertex
+    std::vector<uint64_t> m_threads; // number of threads (cores) for the end-to-end sweep
+    bool m_directed = true; // whether to generate directed graphs
+    bool m_weighted = false; // whether to generate weighted graphs
+    uint64_t m_seed = 42; // seed for the generator
+    std::string m_path_vtxremap; // path to the executable vtxremap, for the end-to-end sweep
+};
+
+/**
+ * A single measurement, one row in the CSV output
+ */
+struct Measurement {
+    std::string m_suite; // e.g. micro, e2e, specialisation
+    std::string m_benchmark; // e.g. reader, dictionary, sort
+    std::string m_variant; // free form description of the configuration
+    uint64_t m_scale = 0; // log2 of the number of vertices in the graph, if applicable
+    uint64_t m_num_edges = 0; // edges processed
+    uint64_t m_num_threads = 1; // threads or cores employed
+    uint64_t m_bytes = 0; // bytes read or written, if applicable
+    double m_seconds = 0; // completion time
+    uint64_t m_max_rss = 0; // peak resident set size, in bytes, if measured
+};
+
+/**
+ * Append the measurements, in CSV, to the given file
+ */
+class CsvWriter {
+    std::fstream m_out;
+
+public:
+    CsvWriter(const std::string& path);
+
+    // Write a single row, flushed immediately
+    void write(const Measurement& m);
+};
+
+/**
+ * Run the setup and the function to measure in a child process, so that each measurement starts with a fresh heap.
+ * Otherwise a dictionary would reuse the nodes freed by the previous measurement, in a scattered order. The setup is
+ * not measured, its result is passed to the function. Return the completion time of the function, in seconds.
+ */
+template<typename Setup, typename Fn>
+double measure(Setup setup, Fn fn);
+
+/**
+ * Parse a comma separated list of integers, e.g. 1,2,4
+ */
+std::vector<uint64_t> parse_list(const std::string& value);
+
+/**
+ * Path to the property file of the R-MAT graph with the given scale, in the working directory. The graph is generated
+ * only if it does not already exist.
+ */
+std::string prepare_graph(const BenchmarkSettings& settings, uint64_t scale);
+
+// Entry points of the benchmark suites
+void run_generate(const BenchmarkSettings& settings);
+void run_micro(const BenchmarkSettings& settings, CsvWriter& csv);
+void run_e2e(const BenchmarkSettings& settings, CsvWriter& csv);
+void run_specialisation(const BenchmarkSettings& settings, CsvWriter& csv);
+
+/*****************************************************************************
+ *                                                                           *
+ *  Implementation                                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+// Fork the process and execute the callback in the child, which reports a double to the parent
+double run_in_child_process(void (*callback)(void* state, double* out_result), void* state);
+
+template<typename Setup, typename Fn>
+double measure(Setup setup, Fn fn){
+    struct State { Setup& m_setup; Fn& m_fn; } state { setup, fn };
+    return run_in_child_process([](void* ptr, double* out_seconds){
+        State* state = reinterpret_cast<State*>(ptr);
+        auto input = state->m_setup();
+        auto t0 = std::chrono::steady_clock::now();
+        state->m_fn(input);
+        *out_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }, &state);
+}
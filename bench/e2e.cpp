@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * End-to-end sweep: run the executable vtxremap over R-MAT graphs of increasing scale, restricted to an increasing
+ * number of cores. The completion time is the wall clock time of the process, the memory its peak resident set size.
+ */
+
+#include "bench.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sched.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/common/error.hpp"
+#include "lib/common/filesystem.hpp"
+#include "graphalytics_reader.hpp"
+
+using namespace std;
+
+namespace {
+
+struct ProcessStats {
+    double m_seconds = 0; // wall clock time
+    uint64_t m_max_rss = 0; // peak resident set size, in bytes
+};
+
+// Execute vtxremap in a child process, restricted to the first `num_threads' cores
+ProcessStats execute(const string& path_vtxremap, const vector<string>& arguments, uint64_t num_threads){
+    vector<char*> argv;
+    argv.push_back(const_cast<char*>(path_vtxremap.c_str()));
+    for(auto& arg : arguments){ argv.push_back(const_cast<char*>(arg.c_str())); }
+    argv.push_back(nullptr);
+
+    auto t0 = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if(pid < 0) ERROR("fork: " << strerror(errno));
+    if(pid == 0){ // child
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for(uint64_t i = 0; i < num_threads; i++){ CPU_SET(i, &cpuset); }
+        if(sched_setaffinity(0, sizeof(cpuset), &cpuset) != 0){ perror("sched_setaffinity"); _exit(1); }
+
+        // discard the progress messages of vtxremap
+        int fd = open("/dev/null", O_WRONLY);
+        if(fd >= 0){ dup2(fd, STDOUT_FILENO); ::close(fd); }
+
+        execv(argv[0], argv.data());
+        perror("execv"); // only reached on error
+        _exit(1);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if(wait4(pid, &status, 0, &usage) < 0) ERROR("wait4: " << strerror(errno));
+    ProcessStats stats;
+    stats.m_seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    stats.m_max_rss = static_cast<uint64_t>(usage.ru_maxrss) * 1024; // KB
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) ERROR("The execution of " << path_vtxremap << " failed");
+
+    return stats;
+}
+
+} // anonymous namespace
+
+void run_e2e(const BenchmarkSettings& settings, CsvWriter& csv){
+    if(!common::filesystem::file_exists(settings.m_path_vtxremap)) INVALID_ARGUMENT("The executable vtxremap does not exist: `" << settings.m_path_vtxremap << "'");
+    uint64_t num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for(uint64_t scale : settings.m_scales){
+        string path_input = prepare_graph(settings, scale);
+        string path_output = settings.m_directory + "/e2e-output.properties";
+        uint64_t num_edges = stoull(GraphalyticsReader{path_input}.get_property("meta.edges"));
+
+        for(uint64_t num_threads : settings.m_threads){
+            if(num_threads > num_cores){
+                cout << "Skipping the sweep with " << num_threads << " threads, only " << num_cores << " cores available" << endl;
+                continue;
+            }
+
+            for(bool is_compressed : { false, true }){
+                vector<string> arguments;
+                if(is_compressed) arguments.push_back("--compress");
+                arguments.push_back(path_input);
+                arguments.push_back(path_output);
+                ProcessStats stats = execute(settings.m_path_vtxremap, arguments, num_threads);
+
+                Measurement m;
+                m.m_suite = "e2e";
+                m.m_benchmark = "vtxremap";
+                m.m_variant = is_compressed ? "zlib" : "plain";
+                m.m_scale = scale;
+                m.m_num_edges = num_edges;
+                m.m_num_threads = num_threads;
+                m.m_bytes = file_size(path_input.substr(0, path_input.size() - string(".properties").size()) + ".e");
+                m.m_seconds = stats.m_seconds;
+                m.m_max_rss = stats.m_max_rss;
+                csv.write(m);
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "lib/common/error.hpp"
+#include "lib/cxxopts.hpp"
+
+#include "bench.hpp"
+
+using namespace std;
+
+#if !defined(VTXREMAP_PATH)
+#define VTXREMAP_PATH "vtxremap"
+#endif
+
+static string g_suite; // the benchmark suite to execute
+static string g_path_output; // the CSV file where to append the results
+static BenchmarkSettings g_settings;
+
+static void parse_command_line_arguments(int argc, char* argv[]);
+
+int main(int argc, char* argv[]){
+    try {
+        parse_command_line_arguments(argc, argv);
+
+        if(g_suite == "generate"){
+            run_generate(g_settings);
+        } else {
+            CsvWriter csv { g_path_output };
+            if(g_suite == "micro" || g_suite == "all"){ run_micro(g_settings, csv); }
+            if(g_suite == "specialisation" || g_suite == "all"){ run_specialisation(g_settings, csv); }
+            if(g_suite == "e2e" || g_suite == "all"){ run_e2e(g_settings, csv); }
+        }
+    } catch (common::Error& e){
+        cerr << e << endl;
+        cerr << "Type `" << argv[0] << " --help' to check how to run the program\n";
+        cerr << "Program terminated" << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void parse_command_line_arguments(int argc, char* argv[]){
+    using namespace cxxopts;
+
+    Options options(argv[0], "Benchmarks for vtxremap, on synthetic R-MAT graphs. Suites: generate, micro, specialisation, e2e or all");
+    options.custom_help(" [options] <suite>");
+    options.add_options()
+            ("d, directory", "Working directory, where to store the generated graphs", value<string>()->default_value("/tmp/vtxremap_bench"))
+            ("e, edge-factor", "Average number of edges per vertex", value<uint64_t>()->default_value("16"))
+            ("h, help", "Show this help menu")
+            ("o, output", "CSV file where to append the results", value<string>()->default_value("vtxremap_bench.csv"))
+            ("s, scale", "log2 of the number of vertices of the graph for the micro benchmarks", value<uint64_t>()->default_value("18"))
+            ("scales", "Comma separated list of scales for the end-to-end sweep", value<string>()->default_value("14,16,18"))
+            ("seed", "Seed for the generator", value<uint64_t>()->default_value("42"))
+            ("t, threads", "Comma separated list of number of cores for the end-to-end sweep", value<string>()->default_value("1"))
+            ("u, undirected", "Generate undirected graphs")
+            ("vtxremap", "Path to the executable vtxremap", value<string>()->default_value(VTXREMAP_PATH))
+            ("w, weighted", "Generate weighted graphs")
+            ;
+
+    auto parsed_args = options.parse(argc, argv);
+
+    if( argc == 1 || parsed_args.count("help") > 0 ){
+        cout << options.help() << endl;
+        exit(EXIT_SUCCESS);
+    }
+
+    if( argc != 2 ) {
+        INVALID_ARGUMENT("Invalid number of arguments: " << argc << ". Expected format: " << argv[0] << " [options] <suite>");
+    }
+    g_suite = argv[1];
+    if(g_suite != "generate" && g_suite != "micro" && g_suite != "specialisation" && g_suite != "e2e" && g_suite != "all"){
+        INVALID_ARGUMENT("Invalid suite: `" << g_suite << "'");
+    }
+
+    g_path_output = parsed_args["output"].as<string>();
+    g_settings.m_directory = parsed_args["directory"].as<string>();
+    g_settings.m_scale = parsed_args["scale"].as<uint64_t>();
+    g_settings.m_scales = parse_list(parsed_args["scales"].as<string>());
+    g_settings.m_edge_factor = parsed_args["edge-factor"].as<uint64_t>();
+    g_settings.m_threads = parse_list(parsed_args["threads"].as<string>());
+    g_settings.m_directed = parsed_args.count("undirected") == 0;
+    g_settings.m_weighted = parsed_args.count("weighted") > 0;
+    g_settings.m_seed = parsed_args["seed"].as<uint64_t>();
+    g_settings.m_path_vtxremap = parsed_args["vtxremap"].as<string>();
+}
@@ -0,0 +1,208 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Micro benchmarks, one for each stage of the pipeline in isolation: reader, dictionary, sort and writers. The input of
+ * each stage is prepared in the setup of the measurement and it is not accounted in the completion time.
+ */
+
+#include "bench.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "edge.hpp"
+#include "graphalytics_reader.hpp"
+#include "pipeline.hpp"
+#include "weight.hpp"
+
+using namespace std;
+
+namespace {
+
+// The edges of the input graph, in a columnar layout, as returned by the reader
+struct Columns {
+    vector<uint64_t> m_sources;
+    vector<uint64_t> m_destinations;
+    vector<double> m_weights;
+};
+
+class MicroBenchmarks {
+    const BenchmarkSettings& m_settings;
+    CsvWriter& m_csv;
+    const string m_path_graph; // the property file of the input graph
+    uint64_t m_num_vertices = 0; // number of vertices in the input graph
+    uint64_t m_num_edges = 0; // number of edges in the input graph
+
+    // Load the whole edge file in memory
+    Columns load_columns() const {
+        GraphalyticsReader reader { m_path_graph, m_settings.m_seed };
+        Columns columns;
+        columns.m_sources.resize(m_num_edges);
+        columns.m_destinations.resize(m_num_edges);
+        columns.m_weights.resize(m_num_edges);
+        uint64_t num_edges = 0, batch_sz = 0;
+        while((batch_sz = reader.read_edges(columns.m_sources.data() + num_edges, columns.m_destinations.data() + num_edges, columns.m_weights.data() + num_edges, m_num_edges - num_edges)) > 0){
+            num_edges += batch_sz;
+        }
+        return columns;
+    }
+
+    // Remap the vertices of the input graph
+    template<typename E>
+    InputGraph<E> load_graph() const {
+        Columns columns = load_columns();
+        VertexDictionary vertices;
+        vertices.reserve(m_num_vertices);
+        uint64_t next_vertex_id = 0;
+        InputGraph<E> graph;
+        graph.m_edges.reserve(m_num_edges);
+        if(m_settings.m_directed){
+            remap_edges<E, true>(vertices, next_vertex_id, columns.m_sources.data(), columns.m_destinations.data(), columns.m_weights.data(), m_num_edges, graph);
+        } else {
+            remap_edges<E, false>(vertices, next_vertex_id, columns.m_sources.data(), columns.m_destinations.data(), columns.m_weights.data(), m_num_edges, graph);
+        }
+        graph.m_num_vertices = next_vertex_id;
+        return graph;
+    }
+
+    void record(const string& benchmark, const string& variant, double seconds, uint64_t bytes = 0){
+        Measurement m;
+        m.m_suite = "micro";
+        m.m_benchmark = benchmark;
+        m.m_variant = variant;
+        m.m_scale = m_settings.m_scale;
+        m.m_num_edges = m_num_edges;
+        m.m_bytes = bytes;
+        m.m_seconds = seconds;
+        m_csv.write(m);
+    }
+
+    void bench_reader(){
+        string path_edges = m_path_graph.substr(0, m_path_graph.size() - string(".properties").size()) + ".e";
+        uint64_t bytes = file_size(path_edges);
+
+        auto run = [&](uint32_t projection){
+            return measure([&](){
+                unique_ptr<GraphalyticsReader> reader { new GraphalyticsReader(m_path_graph, m_settings.m_seed) };
+                reader->set_projection(projection);
+                return reader;
+            }, [&](auto& reader){
+                unique_ptr<uint64_t[]> sources { new uint64_t[g_batch_size] };
+                unique_ptr<uint64_t[]> destinations { new uint64_t[g_batch_size] };
+                unique_ptr<double[]> weights { new double[g_batch_size] };
+                while(reader->read_edges(sources.get(), destinations.get(), weights.get(), g_batch_size) > 0);
+            });
+        };
+
+        record("reader", "all", run(GraphalyticsReader::ALL), bytes);
+        record("reader", "projection", run(GraphalyticsReader::SOURCE | GraphalyticsReader::DESTINATION), bytes);
+    }
+
+    template<typename E>
+    void bench_dictionary(const string& variant){
+        double t = measure([&](){ return load_columns(); }, [&](Columns& columns){
+            VertexDictionary vertices;
+            vertices.reserve(m_num_vertices);
+            uint64_t next_vertex_id = 0;
+            InputGraph<E> graph;
+            graph.m_edges.reserve(m_num_edges);
+            for(uint64_t i = 0; i < m_num_edges; i += g_batch_size){
+                uint64_t batch_sz = min(g_batch_size, m_num_edges - i);
+                if(m_settings.m_directed){
+                    remap_edges<E, true>(vertices, next_vertex_id, columns.m_sources.data() + i, columns.m_destinations.data() + i, columns.m_weights.data() + i, batch_sz, graph);
+                } else {
+                    remap_edges<E, false>(vertices, next_vertex_id, columns.m_sources.data() + i, columns.m_destinations.data() + i, columns.m_weights.data() + i, batch_sz, graph);
+                }
+            }
+        });
+        record("dictionary", variant, t);
+    }
+
+    template<typename E>
+    void bench_sort(const string& variant){
+        double t = measure([&](){ return load_graph<E>(); }, [&](InputGraph<E>& graph){
+            sort_edges(graph);
+        });
+        record("sort", variant, t);
+    }
+
+    template<typename E>
+    void bench_writers(const string& variant){
+        string path_prefix = m_settings.m_directory + "/micro-output";
+        auto setup = [&](){
+            InputGraph<E> graph = load_graph<E>();
+            sort_edges(graph);
+            return graph;
+        };
+
+        for(bool is_compressed : {false, true}){
+            string path_vertices = path_prefix + (is_compressed ? ".vz" : ".v");
+            double t = measure(setup, [&](InputGraph<E>& graph){
+                if(is_compressed){
+                    save_vertices<true>(graph.m_num_vertices, path_vertices);
+                } else {
+                    save_vertices<false>(graph.m_num_vertices, path_vertices);
+                }
+            });
+            record("vertex-writer", string(is_compressed ? "zlib" : "plain"), t, file_size(path_vertices));
+            remove(path_vertices.c_str());
+
+            string path_edges = path_prefix + (is_compressed ? ".ez" : ".e");
+            t = measure(setup, [&](InputGraph<E>& graph){
+                WeightEncoder encoder { WeightType::FLOAT64, graph.m_max_weight };
+                if(is_compressed){
+                    save_edges<E, true>(graph.m_edges, path_edges, encoder);
+                } else {
+                    save_edges<E, false>(graph.m_edges, path_edges, encoder);
+                }
+            });
+            record("edge-writer", variant + (is_compressed ? "-zlib" : "-plain"), t, file_size(path_edges));
+            remove(path_edges.c_str());
+        }
+    }
+
+public:
+    MicroBenchmarks(const BenchmarkSettings& settings, CsvWriter& csv) : m_settings(settings), m_csv(csv), m_path_graph(prepare_graph(settings, settings.m_scale)) {
+        GraphalyticsReader reader { m_path_graph };
+        m_num_vertices = stoull(reader.get_property("meta.vertices"));
+        m_num_edges = stoull(reader.get_property("meta.edges"));
+    }
+
+    void run(){
+        bench_reader();
+        if(m_settings.m_weighted){
+            bench_dictionary<WeightedEdge>("weighted");
+            bench_sort<WeightedEdge>("weighted");
+            bench_writers<WeightedEdge>("weighted");
+        } else {
+            bench_dictionary<Edge>("unweighted");
+            bench_sort<Edge>("unweighted");
+            bench_writers<Edge>("unweighted");
+        }
+    }
+};
+
+} // anonymous namespace
+
+void run_micro(const BenchmarkSettings& settings, CsvWriter& csv){
+    MicroBenchmarks benchmarks { settings, csv };
+    benchmarks.run();
+}
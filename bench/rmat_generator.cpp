@@ -0,0 +1,171 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rmat_generator.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <random>
+
+#include "lib/common/error.hpp"
+#include "lib/common/filesystem.hpp"
+#include "random.hpp"
+#include "weight.hpp"
+
+using namespace std;
+
+RmatGenerator::RmatGenerator(uint64_t scale, uint64_t edge_factor, uint64_t seed) : m_scale(scale), m_edge_factor(edge_factor), m_seed(seed) {
+    if(scale == 0 || scale > 40) INVALID_ARGUMENT("Invalid scale: " << scale);
+    if(edge_factor == 0) INVALID_ARGUMENT("Invalid edge factor: " << edge_factor);
+}
+
+void RmatGenerator::set_directed(bool value){
+    m_directed = value;
+}
+
+void RmatGenerator::set_weighted(bool value){
+    m_weighted = value;
+}
+
+void RmatGenerator::set_shuffle(bool value){
+    m_shuffle = value;
+}
+
+uint64_t RmatGenerator::vertex_id(uint64_t index) const {
+    // finaliser of splitmix64, a bijection over the 64-bit integers: the identifiers are random but unique
+    uint64_t z = index + m_seed * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+vector<WeightedEdge> RmatGenerator::generate() const {
+    const uint64_t num_edges = (1ull << m_scale) * m_edge_factor;
+    const uint32_t threshold_a = m_a * UINT32_MAX;
+    const uint32_t threshold_ab = (m_a + m_b) * UINT32_MAX;
+    const uint32_t threshold_abc = (m_a + m_b + m_c) * UINT32_MAX;
+    Philox4x32 random { m_seed };
+
+    vector<Edge> edges;
+    edges.reserve(num_edges);
+    for(uint64_t i = 0; i < num_edges; i++){
+        uint64_t source = 0, destination = 0;
+        for(uint64_t level = 0; level < m_scale; level += 2){ // two levels for each invocation of the generator
+            uint64_t bits = random(i, level);
+            for(uint64_t j = level; j < min(level +2, m_scale); j++){
+                uint32_t r = static_cast<uint32_t>(bits >> (32 * (j - level)));
+                source <<= 1; destination <<= 1;
+                if(r < threshold_a){ /* top left */ }
+                else if(r < threshold_ab){ destination |= 1; } // top right
+                else if(r < threshold_abc){ source |= 1; } // bottom left
+                else { source |= 1; destination |= 1; } // bottom right
+            }
+        }
+
+        if(source == destination) continue; // self loop
+        if(!m_directed && source > destination) std::swap(source, destination);
+        edges.emplace_back(source, destination);
+    }
+
+    // remove the duplicates
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+    if(m_shuffle){
+        shuffle(edges.begin(), edges.end(), mt19937_64{ m_seed });
+    }
+
+    WeightGenerator weights { m_seed };
+    weights.set_symmetric(!m_directed);
+    vector<WeightedEdge> result;
+    result.reserve(edges.size());
+    for(auto& e : edges){
+        uint64_t source = vertex_id(e.source());
+        uint64_t destination = vertex_id(e.destination());
+        result.emplace_back(source, destination, m_weighted ? weights(source, destination) : 0.0);
+    }
+
+    return result;
+}
+
+// Append an unsigned integer to the buffer
+static char* append(char* buffer, uint64_t value){
+    return to_chars(buffer, buffer + 24, value).ptr;
+}
+
+string RmatGenerator::save(const string& path_prefix) const {
+    string name = common::filesystem::filename(path_prefix);
+    auto edges = generate();
+    uint64_t num_vertices = 1ull << m_scale;
+
+    // vertices, sorted by id
+    vector<uint64_t> vertices (num_vertices);
+    for(uint64_t i = 0; i < num_vertices; i++){ vertices[i] = vertex_id(i); }
+    sort(vertices.begin(), vertices.end());
+    {
+        fstream out { path_prefix + ".v", ios::out | ios::binary };
+        if(!out.good()) ERROR("Cannot create the file `" << path_prefix << ".v'");
+        char buffer[32];
+        for(uint64_t v : vertices){
+            char* end = append(buffer, v);
+            *(end++) = '\n';
+            out.write(buffer, end - buffer);
+        }
+    }
+
+    // edges
+    {
+        fstream out { path_prefix + ".e", ios::out | ios::binary };
+        if(!out.good()) ERROR("Cannot create the file `" << path_prefix << ".e'");
+        char buffer[96];
+        for(auto& e : edges){
+            char* end = append(buffer, e.source());
+            *(end++) = ' ';
+            end = append(end, e.destination());
+            if(m_weighted){
+                *(end++) = ' ';
+                end = to_chars(end, buffer + sizeof(buffer), e.weight(), chars_format::fixed, 6).ptr;
+            }
+            *(end++) = '\n';
+            out.write(buffer, end - buffer);
+        }
+    }
+
+    // properties
+    string path_properties = path_prefix + ".properties";
+    fstream out { path_properties, ios::out };
+    if(!out.good()) ERROR("Cannot create the file `" << path_properties << "'");
+    uint64_t source = edges.empty() ? vertices[0] : edges[0].source();
+    out << "# R-MAT graph, scale: " << m_scale << ", edge factor: " << m_edge_factor << ", seed: " << m_seed << "\n";
+    out << "graph." << name << ".vertex-file = " << name << ".v\n";
+    out << "graph." << name << ".edge-file = " << name << ".e\n";
+    out << "graph." << name << ".meta.vertices = " << num_vertices << "\n";
+    out << "graph." << name << ".meta.edges = " << edges.size() << "\n";
+    out << "graph." << name << ".directed = " << (m_directed ? "true" : "false") << "\n";
+    if(m_weighted){
+        out << "graph." << name << ".edge-properties.names = weight\n";
+        out << "graph." << name << ".edge-properties.types = real\n";
+        out << "graph." << name << ".algorithms = bfs, sssp\n";
+        out << "graph." << name << ".sssp.weight-property = weight\n";
+        out << "graph." << name << ".sssp.source-vertex = " << source << "\n";
+    } else {
+        out << "graph." << name << ".algorithms = bfs\n";
+    }
+    out << "graph." << name << ".bfs.source-vertex = " << source << "\n";
+
+    return path_properties;
+}
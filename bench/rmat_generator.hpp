@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "edge.hpp"
+
+/**
+ * Generator of R-MAT/Kronecker graphs, with the parameters of the Graph500 benchmark. The vertices obtain sparse,
+ * random 64-bit identifiers, as in most of the Graphalytics datasets. Self loops and duplicate edges are removed.
+ * The output is deterministic for a given seed.
+ */
+class RmatGenerator {
+    const uint64_t m_scale; // log2 of the number of vertices
+    const uint64_t m_edge_factor; // number of edges to generate, per vertex
+    const uint64_t m_seed; // seed for the random generator
+    double m_a = 0.57, m_b = 0.19, m_c = 0.19; // probabilities of the quadrants, Graph500, d = 1 - a - b - c
+    bool m_directed = true; // whether the graph is directed
+    bool m_weighted = false; // whether to generate the weights
+    bool m_shuffle = true; // whether to store the edges in random order, rather than sorted by source
+
+public:
+    /**
+     * Initialise the generator for a graph with 2^scale vertices and 2^scale * edge_factor edges, before removing
+     * the self loops and the duplicates
+     */
+    RmatGenerator(uint64_t scale, uint64_t edge_factor, uint64_t seed);
+
+    /**
+     * Set whether the graph is directed
+     */
+    void set_directed(bool value);
+
+    /**
+     * Set whether the graph is weighted
+     */
+    void set_weighted(bool value);
+
+    /**
+     * Set whether to store the edges in random order (default) or sorted by source vertex
+     */
+    void set_shuffle(bool value);
+
+    /**
+     * The sparse identifier of the vertex with the given index, in [0, 2^scale)
+     */
+    uint64_t vertex_id(uint64_t index) const;
+
+    /**
+     * Generate the list of edges, in terms of the sparse vertex identifiers
+     */
+    std::vector<WeightedEdge> generate() const;
+
+    /**
+     * Generate the graph and save it in the Graphalytics format: <path_prefix>.properties, .v and .e.
+     * Return the path to the property file.
+     */
+    std::string save(const std::string& path_prefix) const;
+};
@@ -0,0 +1,197 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Compare the inner loops of the pipeline specialised on the properties of the graph (directed, weighted) against
+ * the generic loops they replaced, where the same properties were evaluated for each edge and all edges carried a
+ * weight.
+ */
+
+#include "bench.hpp"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "edge.hpp"
+#include "pipeline.hpp"
+#include "weight.hpp"
+
+using namespace std;
+
+/*****************************************************************************
+ *                                                                           *
+ *  Generic kernels                                                          *
+ *                                                                           *
+ *****************************************************************************/
+
+// The remap loop before the specialisation: always WeightedEdge, the properties are checked for each edge
+static void remap_edges_generic(VertexDictionary& vertices, uint64_t& next_vertex_id, const uint64_t* sources,
+        const uint64_t* destinations, const double* weights, uint64_t num_edges, bool is_directed, bool is_weighted, InputGraph<WeightedEdge>& output){
+    using P = VertexDictionary::value_type;
+    for(uint64_t i = 0; i < num_edges; i++){
+        WeightedEdge edge;
+        if(is_weighted){ edge.m_weight = weights[i]; }
+
+        auto v1 = vertices.insert(P{sources[i], next_vertex_id});
+        if(v1.second){ next_vertex_id++; } // new vertex
+        edge.m_source = v1.first->second;
+
+        auto v2 = vertices.insert(P{destinations[i], next_vertex_id});
+        if(v2.second){ next_vertex_id++; } // new vertex
+        edge.m_destination = v2.first->second;
+
+        if(!is_directed && edge.m_source > edge.m_destination) std::swap(edge.m_source, edge.m_destination); // src < dst
+
+        output.m_edges.push_back(edge);
+    }
+}
+
+// The serialisation of the edges before the specialisation, the weights are checked for each edge
+static uint64_t serialise_edges_generic(const WeightedEdge* edges, uint64_t num_edges, bool is_weighted, char* out){
+    uint64_t* buffer = reinterpret_cast<uint64_t*>(out);
+    uint64_t increment = is_weighted ? 3 : 2;
+    for(uint64_t i = 0, j = 0; i < num_edges; i++, j += increment){
+        buffer[j] = edges[i].source();
+        buffer[j +1] = edges[i].destination();
+        if(is_weighted){ reinterpret_cast<double*>(buffer)[j +2] = edges[i].m_weight; }
+    }
+    return num_edges * increment * sizeof(uint64_t);
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  Driver                                                                   *
+ *                                                                           *
+ *****************************************************************************/
+
+struct Input {
+    vector<uint64_t> m_sources;
+    vector<uint64_t> m_destinations;
+    vector<double> m_weights;
+};
+
+static Input generate_input(uint64_t num_vertices, uint64_t num_edges){
+    mt19937_64 random { 42 };
+    vector<uint64_t> vertex_ids (num_vertices);
+    for(auto& v : vertex_ids) v = random();
+    Input input;
+    input.m_sources.resize(num_edges); input.m_destinations.resize(num_edges); input.m_weights.resize(num_edges);
+    for(uint64_t i = 0; i < num_edges; i++){
+        uint64_t src = random() % num_vertices, dst = random() % num_vertices;
+        if(src == dst) dst = (dst +1) % num_vertices;
+        input.m_sources[i] = vertex_ids[src];
+        input.m_destinations[i] = vertex_ids[dst];
+        input.m_weights[i] = (random() % 1000 + 1) / 1000.0;
+    }
+    return input;
+}
+
+static void record(CsvWriter& csv, const BenchmarkSettings& settings, const string& kernel, const string& variant, bool is_directed, bool is_weighted, uint64_t num_edges, double seconds){
+    Measurement m;
+    m.m_suite = "specialisation";
+    m.m_benchmark = kernel;
+    m.m_variant = variant + (is_directed ? "-directed" : "-undirected") + (is_weighted ? "-weighted" : "-unweighted");
+    m.m_scale = settings.m_scale;
+    m.m_num_edges = num_edges;
+    m.m_seconds = seconds;
+    csv.write(m);
+}
+
+template<typename E, bool is_directed>
+static void bench_remap(const BenchmarkSettings& settings, CsvWriter& csv, const Input& input, uint64_t num_vertices){
+    uint64_t num_edges = input.m_sources.size();
+    constexpr bool is_weighted = has_weight<E>;
+
+    auto setup = [&](auto output){
+        unique_ptr<VertexDictionary> vertices { new VertexDictionary() };
+        vertices->reserve(num_vertices);
+        output.m_edges.reserve(num_edges);
+        return make_pair(move(vertices), move(output));
+    };
+
+    double t = measure([&](){ return setup(InputGraph<WeightedEdge>{}); }, [&](auto& state){
+        uint64_t next_vertex_id = 0;
+        for(uint64_t i = 0; i < num_edges; i += g_batch_size){
+            uint64_t batch_sz = min(g_batch_size, num_edges - i);
+            remap_edges_generic(*state.first, next_vertex_id, input.m_sources.data() + i, input.m_destinations.data() + i, input.m_weights.data() + i, batch_sz, is_directed, is_weighted, state.second);
+        }
+    });
+    record(csv, settings, "remap", "generic", is_directed, is_weighted, num_edges, t);
+
+    t = measure([&](){ return setup(InputGraph<E>{}); }, [&](auto& state){
+        uint64_t next_vertex_id = 0;
+        for(uint64_t i = 0; i < num_edges; i += g_batch_size){
+            uint64_t batch_sz = min(g_batch_size, num_edges - i);
+            remap_edges<E, is_directed>(*state.first, next_vertex_id, input.m_sources.data() + i, input.m_destinations.data() + i, input.m_weights.data() + i, batch_sz, state.second);
+        }
+    });
+    record(csv, settings, "remap", "specialised", is_directed, is_weighted, num_edges, t);
+}
+
+template<typename E>
+static void bench_serialise(const BenchmarkSettings& settings, CsvWriter& csv, const Input& input){
+    uint64_t num_edges = input.m_sources.size();
+    constexpr bool is_weighted = has_weight<E>;
+    vector<WeightedEdge> edges_generic (num_edges);
+    vector<E> edges (num_edges);
+    for(uint64_t i = 0; i < num_edges; i++){
+        edges_generic[i] = WeightedEdge { input.m_sources[i], input.m_destinations[i], input.m_weights[i] };
+        edges[i].m_source = input.m_sources[i];
+        edges[i].m_destination = input.m_destinations[i];
+        if constexpr(is_weighted){ edges[i].m_weight = input.m_weights[i]; }
+    }
+    constexpr uint64_t chunk_sz = 1ull << 20; // as in save_edges
+    unique_ptr<uint64_t[]> buffer { new uint64_t[chunk_sz * 3] };
+    char* out = reinterpret_cast<char*>(buffer.get());
+    WeightEncoder encoder { WeightType::FLOAT64, 1.0 };
+    uint64_t checksum = 0;
+
+    auto no_setup = [](){ return 0; };
+
+    double t = measure(no_setup, [&](int){
+        for(uint64_t i = 0; i < num_edges; i += chunk_sz){
+            checksum += serialise_edges_generic(edges_generic.data() + i, min(chunk_sz, num_edges - i), is_weighted, out);
+        }
+        if(checksum == 0) cerr << "unexpected checksum" << endl; // do not optimise away the loops
+    });
+    record(csv, settings, "serialise", "generic", true, is_weighted, num_edges, t);
+
+    t = measure(no_setup, [&](int){
+        for(uint64_t i = 0; i < num_edges; i += chunk_sz){
+            checksum += serialise_edges(edges.data() + i, min(chunk_sz, num_edges - i), encoder, out);
+        }
+        if(checksum == 0) cerr << "unexpected checksum" << endl; // do not optimise away the loops
+    });
+    record(csv, settings, "serialise", "specialised", true, is_weighted, num_edges, t);
+}
+
+void run_specialisation(const BenchmarkSettings& settings, CsvWriter& csv){
+    uint64_t num_vertices = 1ull << settings.m_scale;
+    uint64_t num_edges = num_vertices * settings.m_edge_factor;
+
+    Input input = generate_input(num_vertices, num_edges);
+
+    bench_remap<Edge, true>(settings, csv, input, num_vertices);
+    bench_remap<Edge, false>(settings, csv, input, num_vertices);
+    bench_remap<WeightedEdge, true>(settings, csv, input, num_vertices);
+    bench_remap<WeightedEdge, false>(settings, csv, input, num_vertices);
+    bench_serialise<Edge>(settings, csv, input);
+    bench_serialise<WeightedEdge>(settings, csv, input);
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+ * A FIFO queue with a bounded capacity, to connect the producer and the consumer of two stages running in different
+ * threads. The producer blocks while the queue is full, the consumer while the queue is empty. The producer closes the
+ * queue once it has pushed all elements. A queue can also be cancelled, to unblock both sides when a stage fails.
+ */
+template<typename T>
+class BoundedQueue {
+    std::mutex m_mutex;
+    std::condition_variable m_cv_not_empty; // wait for an element to be pushed
+    std::condition_variable m_cv_not_full; // wait for an element to be popped
+    std::deque<T> m_queue;
+    const size_t m_capacity; // max number of elements in the queue
+    bool m_closed = false; // no more elements will be pushed
+    bool m_cancelled = false; // the pipeline has been aborted
+
+public:
+    /**
+     * Create a queue with the given capacity
+     */
+    BoundedQueue(size_t capacity) : m_capacity(capacity) { }
+
+    /**
+     * Append an element, waiting while the queue is full. Return false if the queue has been cancelled.
+     */
+    bool push(T element){
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv_not_full.wait(lock, [&](){ return m_queue.size() < m_capacity || m_cancelled; });
+        if(m_cancelled) return false;
+        m_queue.push_back(std::move(element));
+        lock.unlock();
+        m_cv_not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * Remove the first element, waiting while the queue is empty. Return false if the queue has been closed and all
+     * elements have already been consumed, or it has been cancelled.
+     */
+    bool pop(T& out_element){
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv_not_empty.wait(lock, [&](){ return !m_queue.empty() || m_closed || m_cancelled; });
+        if(m_cancelled || m_queue.empty()) return false;
+        out_element = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        m_cv_not_full.notify_one();
+        return true;
+    }
+
+    /**
+     * Signal that no more elements will be pushed
+     */
+    void close(){
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_cv_not_empty.notify_all();
+    }
+
+    /**
+     * Abort the pipeline, unblocking both the producer and the consumer
+     */
+    void cancel(){
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+        m_cv_not_empty.notify_all();
+        m_cv_not_full.notify_all();
+    }
+
+    /**
+     * Whether the pipeline has been aborted
+     */
+    bool is_cancelled(){
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        return m_cancelled;
+    }
+};
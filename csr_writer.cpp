@@ -0,0 +1,42 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "csr_writer.hpp"
+
+using namespace std;
+
+CsrWriter::CsrWriter(const string& path, uint64_t num_vertices, uint64_t weight_width) : m_out(path), m_num_vertices(num_vertices),
+        m_record_size(sizeof(uint64_t) + weight_width), m_offsets(num_vertices +1), m_buffer(new char[s_buffer_capacity * (sizeof(uint64_t) + weight_width)]) {
+
+}
+
+void CsrWriter::close(){
+    while(m_next_vertex <= m_num_vertices){ m_offsets[m_next_vertex++] = m_num_edges; }
+
+    CsrTrailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    memcpy(trailer.m_magic, "VTXCSR01", sizeof(trailer.m_magic));
+    trailer.m_num_vertices = m_num_vertices;
+    trailer.m_num_edges = m_num_edges;
+    trailer.m_record_size = m_record_size;
+    trailer.m_weight_width = m_record_size - sizeof(uint64_t);
+    trailer.m_offsets_position = m_out.bytes_written();
+
+    m_out.write(reinterpret_cast<const char*>(m_offsets.data()), m_offsets.size() * sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    m_out.close();
+}
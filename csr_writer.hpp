@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "async_writer.hpp"
+#include "edge.hpp"
+#include "weight.hpp"
+
+/**
+ * Writer of a graph in the binary compressed sparse row format (.csr). The edges are streamed in sorted order, by
+ * source and destination, and the offsets of each vertex are stored after the edges, so that the file can be written
+ * sequentially. Layout of the file, all integers are in little endian:
+ *
+ *   - the edges: for each edge, the destination (uint64_t) followed, in weighted graphs, by the weight in the binary
+ *     representation of the WeightEncoder, e.g. 2 bytes for fixed16;
+ *   - the offsets: num_vertices + 1 uint64_t, the position of the first edge of each vertex, the edges of the
+ *     vertex `v' are in [offsets[v], offsets[v+1]);
+ *   - a trailer of 64 bytes, see CsrTrailer, to be read first from the end of the file.
+ */
+class CsrWriter {
+    AsyncWriter m_out; // the output file
+    const uint64_t m_num_vertices; // number of vertices in the graph
+    const uint64_t m_record_size; // bytes for each edge, the destination + the weight
+    std::vector<uint64_t> m_offsets; // the position of the first edge of each vertex
+    uint64_t m_num_edges = 0; // number of edges written so far
+    uint64_t m_next_vertex = 0; // the next vertex whose offset is not set yet
+    std::unique_ptr<char[]> m_buffer; // to serialise a batch of edges
+
+    static constexpr uint64_t s_buffer_capacity = (1ull << 16); // number of edges serialised at the time
+
+public:
+    /**
+     * Create the file. The argument weight_width is the size in bytes of a weight, or 0 when the edges are of type Edge
+     */
+    CsrWriter(const std::string& path, uint64_t num_vertices, uint64_t weight_width);
+
+    /**
+     * Append the next edges, sorted by source and destination, following the edges already appended
+     */
+    template<typename E>
+    void append(const E* edges, uint64_t num_edges, WeightEncoder& encoder);
+
+    /**
+     * Write the offsets and the trailer, then close the file. A writer destroyed without being closed, e.g. after an
+     * error, removes its file, as AsyncWriter.
+     */
+    void close();
+
+    /**
+     * Total number of bytes written
+     */
+    uint64_t bytes_written() const { return m_out.bytes_written(); }
+};
+
+/**
+ * The last 64 bytes of a .csr file
+ */
+struct CsrTrailer {
+    char m_magic[8]; // VTXCSR01
+    uint64_t m_num_vertices; // number of vertices
+    uint64_t m_num_edges; // number of edges
+    uint64_t m_record_size; // bytes for each edge, the destination + the weight
+    uint64_t m_weight_width; // bytes for each weight, 0 if the graph is not weighted
+    uint64_t m_offsets_position; // position of the offsets in the file, in bytes
+    uint64_t m_unused[2]; // padding
+};
+static_assert(sizeof(CsrTrailer) == 64, "Expected 64 bytes");
+
+// Implementation details
+template<typename E>
+void CsrWriter::append(const E* edges, uint64_t num_edges, WeightEncoder& encoder){
+    for(uint64_t i = 0; i < num_edges; i += s_buffer_capacity){
+        const uint64_t batch_sz = std::min(num_edges - i, s_buffer_capacity);
+        char* out = m_buffer.get();
+        for(uint64_t j = 0; j < batch_sz; j++){
+            const E& edge = edges[i + j];
+            while(m_next_vertex <= edge.source()){ m_offsets[m_next_vertex++] = m_num_edges; }
+            uint64_t destination = edge.destination();
+            memcpy(out, &destination, sizeof(uint64_t));
+            if constexpr(!std::is_same_v<E, Edge>){ encoder.encode(edge.weight(), out + sizeof(uint64_t)); }
+            out += m_record_size;
+            m_num_edges++;
+        }
+        m_out.write(m_buffer.get(), out - m_buffer.get());
+    }
+}
@@ -0,0 +1,81 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "dictionary_statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace std;
+
+// max number of buckets to inspect in analyse()
+constexpr uint64_t g_max_buckets_sampled = (1ull << 20);
+
+double DictionaryStatistics::hit_rate() const {
+    return m_num_lookups > 0 ? static_cast<double>(m_num_lookups - m_num_inserts) / m_num_lookups : 0;
+}
+
+void DictionaryStatistics::analyse(const VertexDictionary& dictionary){
+    m_num_entries = dictionary.size();
+    m_num_buckets = dictionary.bucket_count();
+    m_load_factor = dictionary.load_factor();
+    m_expected_empty_buckets = exp(-m_load_factor); // Poisson distribution, probability of zero entries
+    m_probe_histogram.clear();
+    m_max_probe_length = 0;
+    if(m_num_buckets == 0) return;
+
+    uint64_t stride = max<uint64_t>(1, m_num_buckets / g_max_buckets_sampled);
+    uint64_t num_empty = 0, num_entries = 0, sum_probes = 0;
+    m_num_buckets_sampled = 0;
+    for(uint64_t b = 0; b < m_num_buckets; b += stride){
+        uint64_t length = dictionary.bucket_size(b);
+        m_num_buckets_sampled++;
+        if(length == 0){ num_empty++; continue; }
+        if(m_probe_histogram.size() < length) m_probe_histogram.resize(length);
+        for(uint64_t i = 0; i < length; i++){ m_probe_histogram[i]++; } // one entry at each distance in the chain
+        num_entries += length;
+        sum_probes += length * (length +1) / 2;
+        m_max_probe_length = max(m_max_probe_length, length);
+    }
+
+    m_empty_buckets = static_cast<double>(num_empty) / m_num_buckets_sampled;
+    m_mean_probe_length = num_entries > 0 ? static_cast<double>(sum_probes) / num_entries : 0;
+}
+
+bool DictionaryStatistics::is_skewed() const {
+    if(m_num_buckets_sampled < 1024 || m_load_factor < 0.1) return false; // not enough data
+    return m_empty_buckets > m_expected_empty_buckets + 0.1; // the entries are clustered in a subset of the buckets
+}
+
+ostream& operator<<(ostream& out, const DictionaryStatistics& stats){
+    auto flags = out.flags();
+    out << fixed << setprecision(3);
+    out << "Dictionary: " << stats.m_num_entries << " vertices, " << stats.m_num_buckets << " buckets, load factor: " << stats.m_load_factor
+        << ", rehashes: " << stats.m_num_rehashes << "\n";
+    out << "Dictionary: lookups: " << stats.m_num_lookups << ", inserts: " << stats.m_num_inserts << ", hit rate: " << stats.hit_rate() << "\n";
+    out << "Dictionary: empty buckets: " << stats.m_empty_buckets << " (expected: " << stats.m_expected_empty_buckets << "), "
+        << "mean probe length: " << stats.m_mean_probe_length << ", max probe length: " << stats.m_max_probe_length;
+    if(stats.m_num_buckets_sampled < stats.m_num_buckets){ out << ", sampled buckets: " << stats.m_num_buckets_sampled; }
+    out << "\n";
+    out << "Dictionary: probe distance histogram:";
+    for(uint64_t i = 0; i < stats.m_probe_histogram.size(); i++){
+        out << " [" << (i +1) << "] " << stats.m_probe_histogram[i];
+    }
+    out.flags(flags);
+    return out;
+}
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "memory_policy.hpp"
+
+/**
+ * The vertex dictionary, the hash table mapping the vertex IDs of the input graph into the dense domain
+ * [0, num_vertices). Its nodes and buckets are allocated according to the global memory policy.
+ */
+using VertexDictionary = std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, PolicyAllocator<std::pair<const uint64_t, uint64_t>>>;
+
+/**
+ * Statistics on the vertex dictionary, the hash table mapping the vertex IDs of the input graph into the dense
+ * domain [0, num_vertices). The counters of the operations (lookups, inserts, rehashes) are maintained while remapping
+ * the edges, the shape of the table (chain lengths) is analysed at the end, by analyse().
+ */
+struct DictionaryStatistics {
+    // counters
+    uint64_t m_num_lookups = 0; // vertices searched
+    uint64_t m_num_inserts = 0; // vertices not found and thus inserted
+    uint64_t m_num_rehashes = 0; // number of times the table has been resized
+    uint64_t m_last_bucket_count = 0; // number of buckets before the last insertion, to detect the rehashes
+
+    // shape of the table, set by analyse()
+    uint64_t m_num_entries = 0; // number of vertices in the dictionary
+    uint64_t m_num_buckets = 0; // total number of buckets in the table
+    double m_load_factor = 0; // entries / buckets
+    uint64_t m_num_buckets_sampled = 0; // buckets inspected to compute the histogram, all of them for small tables
+    double m_empty_buckets = 0; // fraction of the sampled buckets that are empty
+    double m_expected_empty_buckets = 0; // fraction of empty buckets expected with a uniform hash function
+    double m_mean_probe_length = 0; // average number of nodes to traverse to find an entry
+    uint64_t m_max_probe_length = 0; // longest chain in the sampled buckets
+    std::vector<uint64_t> m_probe_histogram; // [i] = number of sampled entries at distance i + 1 from the head of their chain
+
+    /**
+     * Record an insertion in the dictionary, to detect whether the table has been resized
+     */
+    void on_insert(uint64_t bucket_count){
+        if(bucket_count != m_last_bucket_count){
+            if(m_last_bucket_count > 0){ m_num_rehashes++; }
+            m_last_bucket_count = bucket_count;
+        }
+    }
+
+    /**
+     * Ratio of the lookups that found the vertex already in the dictionary
+     */
+    double hit_rate() const;
+
+    /**
+     * Inspect the buckets of the table. For large tables, only a sample of the buckets is inspected, at a fixed
+     * stride, to keep the cost independent of the size of the graph.
+     */
+    void analyse(const VertexDictionary& dictionary);
+
+    /**
+     * Check whether the chains are significantly longer than those expected with a uniform hash function, that is,
+     * the distribution of the vertex IDs defeats the hash function
+     */
+    bool is_skewed() const;
+};
+
+/**
+ * Print the statistics in a human readable form, over multiple lines
+ */
+std::ostream& operator<<(std::ostream& out, const DictionaryStatistics& stats);
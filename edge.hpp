@@ -37,9 +37,31 @@ struct WeightedEdge : public Edge {
     Edge edge() const;
 };
 
+/**
+ * Weighted edge storing the weight in single precision. Its layout is packed into 20 bytes, rather than the 24 bytes
+ * of a WeightedEdge, to reduce the footprint of the edge array when the weights do not require double precision.
+ */
+#pragma pack(push, 4)
+struct CompactWeightedEdge : public Edge {
+    float m_weight;
+
+    CompactWeightedEdge() : Edge(), m_weight(0) { }
+    CompactWeightedEdge(uint64_t src, uint64_t dst, float weight) : Edge{src, dst}, m_weight(weight) { }
+    float weight() const { return m_weight; }
+};
+#pragma pack(pop)
+
 std::ostream& operator<<(std::ostream& out, const Edge& e);
 std::ostream& operator<<(std::ostream& out, const WeightedEdge& e);
 
+// order of the edges in the output, by source and then by destination
+struct EdgeOrder {
+    template<typename E>
+    bool operator()(const E& e1, const E& e2) const {
+        return (e1.m_source < e2.m_source) || (e1.m_source == e2.m_source && e1.m_destination < e2.m_destination);
+    }
+};
+
 namespace std {
 template<>
 struct hash<Edge> { // hash function for graph::Edge
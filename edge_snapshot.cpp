@@ -0,0 +1,180 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "edge_snapshot.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/common/error.hpp"
+#include "lib/common/filesystem.hpp"
+
+using namespace std;
+
+struct EdgeSnapshot::Header {
+    char m_magic[8]; // VTXSNAP + version
+    uint64_t m_num_edges; // number of records
+    uint64_t m_is_weighted; // whether the records contain the weights
+    uint64_t m_input_size; // size of the edge file, in bytes
+    int64_t m_input_mtime; // modification time of the edge file, in nanoseconds
+    uint64_t m_content_hash; // hash of a sample of the edge file
+    char m_input_path[4048]; // absolute path of the edge file, null terminated
+};
+static_assert(sizeof(EdgeSnapshot::Header) == 4096, "The records should start at a page boundary");
+
+namespace {
+
+constexpr char g_magic[8] = { 'V', 'T', 'X', 'S', 'N', 'A', 'P', '1' };
+
+// Identity of an edge file
+struct Fingerprint {
+    string m_path; // absolute path
+    uint64_t m_size = 0; // in bytes
+    int64_t m_mtime = 0; // in nanoseconds
+    uint64_t m_hash = 0; // FNV-1a over a sample of blocks
+};
+
+Fingerprint fingerprint(const string& path_edge_file){
+    Fingerprint result;
+    result.m_path = common::filesystem::absolute_path(path_edge_file);
+
+    int fd = ::open(path_edge_file.c_str(), O_RDONLY);
+    if(fd < 0) ERROR("Cannot open the file `" << path_edge_file << "': " << strerror(errno));
+    struct stat info;
+    if(fstat(fd, &info) != 0){ int error = errno; ::close(fd); ERROR("Cannot stat the file `" << path_edge_file << "': " << strerror(error)); }
+    result.m_size = info.st_size;
+    result.m_mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+
+    // hash 64 blocks of 16 KB, evenly spaced, including the first and the last block of the file
+    constexpr uint64_t num_blocks = 64, block_size = (1ull << 14);
+    vector<char> buffer(block_size);
+    uint64_t hash = 14695981039346656037ull; // FNV offset basis
+    for(uint64_t i = 0; i < num_blocks; i++){
+        uint64_t offset = result.m_size <= block_size ? 0 : (result.m_size - block_size) / (num_blocks -1) * i;
+        if(i == num_blocks -1 && result.m_size > block_size){ offset = result.m_size - block_size; }
+        ssize_t bytes_read = pread(fd, buffer.data(), block_size, offset);
+        if(bytes_read < 0){ int error = errno; ::close(fd); ERROR("Cannot read the file `" << path_edge_file << "': " << strerror(error)); }
+        for(ssize_t j = 0; j < bytes_read; j++){
+            hash = (hash ^ static_cast<unsigned char>(buffer[j])) * 1099511628211ull; // FNV prime
+        }
+        if(result.m_size <= block_size) break;
+    }
+    ::close(fd);
+    result.m_hash = hash;
+
+    return result;
+}
+
+} // anonymous namespace
+
+/*****************************************************************************
+ *                                                                           *
+ *  EdgeSnapshot                                                             *
+ *                                                                           *
+ *****************************************************************************/
+
+EdgeSnapshot::~EdgeSnapshot(){
+    if(m_mapping != nullptr){ munmap(m_mapping, m_mapping_size); }
+}
+
+string EdgeSnapshot::path(const string& path_edge_file){
+    return path_edge_file + ".snapshot";
+}
+
+unique_ptr<EdgeSnapshot> EdgeSnapshot::open(const string& path_edge_file, bool is_weighted){
+    string path_snapshot = path(path_edge_file);
+    int fd = ::open(path_snapshot.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr; // the snapshot does not exist
+    struct stat info;
+    if(fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < sizeof(Header)){ ::close(fd); return nullptr; }
+
+    unique_ptr<EdgeSnapshot> snapshot { new EdgeSnapshot() };
+    snapshot->m_mapping_size = info.st_size;
+    snapshot->m_mapping = mmap(nullptr, snapshot->m_mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping remains valid
+    if(snapshot->m_mapping == MAP_FAILED){ snapshot->m_mapping = nullptr; return nullptr; }
+    madvise(snapshot->m_mapping, snapshot->m_mapping_size, MADV_SEQUENTIAL);
+
+    // validate the snapshot
+    const Header* header = reinterpret_cast<const Header*>(snapshot->m_mapping);
+    if(memcmp(header->m_magic, g_magic, sizeof(g_magic)) != 0) return nullptr;
+    if(is_weighted && !header->m_is_weighted) return nullptr;
+    const uint64_t record_size = (header->m_is_weighted ? 3 : 2) * sizeof(uint64_t);
+    if(snapshot->m_mapping_size != sizeof(Header) + header->m_num_edges * record_size) return nullptr; // truncated
+    Fingerprint input = fingerprint(path_edge_file);
+    if(input.m_size != header->m_input_size || input.m_mtime != header->m_input_mtime || input.m_hash != header->m_content_hash ||
+            strncmp(input.m_path.c_str(), header->m_input_path, sizeof(header->m_input_path)) != 0){
+        return nullptr; // stale
+    }
+
+    snapshot->m_edges = reinterpret_cast<const char*>(snapshot->m_mapping) + sizeof(Header);
+    snapshot->m_num_edges = header->m_num_edges;
+    snapshot->m_record_size = record_size;
+    snapshot->m_is_weighted = header->m_is_weighted;
+    return snapshot;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  EdgeSnapshotWriter                                                       *
+ *                                                                           *
+ *****************************************************************************/
+
+EdgeSnapshotWriter::EdgeSnapshotWriter(const string& path_edge_file, bool is_weighted) : m_path_edge_file(path_edge_file),
+        m_path_temporary(EdgeSnapshot::path(path_edge_file) + ".tmp." + to_string(getpid())), m_is_weighted(is_weighted) {
+    m_out.open(m_path_temporary, ios::out | ios::binary | ios::trunc);
+    if(!m_out.good()) ERROR("Cannot create the file " << m_path_temporary);
+    EdgeSnapshot::Header header;
+    memset(&header, 0, sizeof(header));
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header)); // placeholder, written again in commit()
+}
+
+EdgeSnapshotWriter::~EdgeSnapshotWriter(){
+    if(!m_committed){
+        m_out.close();
+        unlink(m_path_temporary.c_str());
+    }
+}
+
+void EdgeSnapshotWriter::commit(){
+    Fingerprint input = fingerprint(m_path_edge_file);
+    if(input.m_path.size() >= sizeof(EdgeSnapshot::Header::m_input_path)) ERROR("The path of the edge file is too long: " << input.m_path);
+
+    EdgeSnapshot::Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, g_magic, sizeof(g_magic));
+    header.m_num_edges = m_num_edges;
+    header.m_is_weighted = m_is_weighted;
+    header.m_input_size = input.m_size;
+    header.m_input_mtime = input.m_mtime;
+    header.m_content_hash = input.m_hash;
+    strncpy(header.m_input_path, input.m_path.c_str(), sizeof(header.m_input_path) -1);
+
+    m_out.seekp(0);
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_out.close();
+    if(m_out.fail()) ERROR("Cannot write the file " << m_path_temporary);
+
+    string path_snapshot = EdgeSnapshot::path(m_path_edge_file);
+    if(rename(m_path_temporary.c_str(), path_snapshot.c_str()) != 0) ERROR("Cannot rename " << m_path_temporary << " into " << path_snapshot << ": " << strerror(errno));
+    m_committed = true;
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+/**
+ * Binary snapshot of a parsed edge list, to skip parsing the text edge file of the same graph in the next runs. The
+ * snapshot is stored next to the edge file, as <edge file>.snapshot, and it is mapped in memory with mmap. It contains
+ * the edges in the same order of the edge file, as read from the text, that is, neither swapped for undirected graphs
+ * nor with the generated weights: records of (source, destination), or (source, destination, weight) for weighted
+ * graphs.
+ *
+ * A snapshot is valid as long as its edge file has the same path, size, modification time and content hash. The
+ * content hash is computed on a sample of blocks of the edge file, rather than on the whole file, to keep the check
+ * cheap compared to the parsing.
+ */
+class EdgeSnapshot {
+public:
+    struct Header; // first page of the file
+
+private:
+    void* m_mapping = nullptr; // the whole file
+    uint64_t m_mapping_size = 0; // size of the mapping, in bytes
+    const char* m_edges = nullptr; // the records, after the header
+    uint64_t m_num_edges = 0; // the number of records
+    uint64_t m_record_size = 0; // 16 bytes, or 24 bytes with the weights
+    bool m_is_weighted = false; // whether the records contain the weights
+
+    EdgeSnapshot() = default;
+
+public:
+    ~EdgeSnapshot();
+
+    /**
+     * The path of the snapshot for the given edge file
+     */
+    static std::string path(const std::string& path_edge_file);
+
+    /**
+     * Open the snapshot of the given edge file. Return a nullptr if the snapshot does not exist, it is not valid any
+     * more, or it does not contain the weights when requested
+     */
+    static std::unique_ptr<EdgeSnapshot> open(const std::string& path_edge_file, bool is_weighted);
+
+    /**
+     * Number of edges in the snapshot
+     */
+    uint64_t num_edges() const { return m_num_edges; }
+
+    /**
+     * Whether the edges have a weight
+     */
+    bool is_weighted() const { return m_is_weighted; }
+
+    /**
+     * Retrieve the edge at the given position. The weight is not set if the snapshot is not weighted
+     */
+    void get(uint64_t position, uint64_t& out_source, uint64_t& out_destination, double& out_weight) const {
+        const char* record = m_edges + position * m_record_size;
+        out_source = reinterpret_cast<const uint64_t*>(record)[0];
+        out_destination = reinterpret_cast<const uint64_t*>(record)[1];
+        if(m_is_weighted){ out_weight = reinterpret_cast<const double*>(record)[2]; }
+    }
+};
+
+/**
+ * Create the snapshot of an edge file. The edges are first stored in a temporary file, which replaces the snapshot
+ * only in commit(), so that concurrent or interrupted runs never leave a partial snapshot behind.
+ */
+class EdgeSnapshotWriter {
+    const std::string m_path_edge_file; // the source of the snapshot
+    const std::string m_path_temporary; // where the edges are written
+    const bool m_is_weighted; // whether to store the weights
+    std::fstream m_out; // handle to the temporary file
+    uint64_t m_num_edges = 0; // number of edges appended so far
+    bool m_committed = false; // whether commit() has been invoked
+
+public:
+    /**
+     * Start the snapshot of the given edge file
+     */
+    EdgeSnapshotWriter(const std::string& path_edge_file, bool is_weighted);
+
+    /**
+     * Remove the temporary file, if the snapshot has not been committed
+     */
+    ~EdgeSnapshotWriter();
+
+    /**
+     * Append an edge to the snapshot
+     */
+    void append(uint64_t source, uint64_t destination, double weight){
+        uint64_t record[3] = { source, destination, 0 };
+        if(m_is_weighted){ memcpy(record + 2, &weight, sizeof(double)); }
+        m_out.write(reinterpret_cast<const char*>(record), (m_is_weighted ? 3 : 2) * sizeof(uint64_t));
+        m_num_edges++;
+    }
+
+    /**
+     * Write the header and replace the snapshot with the new file
+     */
+    void commit();
+};
@@ -19,11 +19,15 @@
 
 #include <cassert>
 #include <cctype>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
-#include <random>
+#include <memory>
 #include <regex>
+#include <unistd.h>
 #include "lib/common/filesystem.hpp"
 
 using namespace std;
@@ -49,7 +53,7 @@ using namespace std;
  *  Initialisation                                                           *
  *                                                                           *
  *****************************************************************************/
-GraphalyticsReader::GraphalyticsReader(const std::string& path_properties, uint64_t seed) : m_random_generator(seed) {
+GraphalyticsReader::GraphalyticsReader(const std::string& path_properties, uint64_t seed) : m_weight_generator(seed) {
     if(!common::filesystem::file_exists(path_properties)) ERROR("The given file does not exist: " << path_properties);
     string abs_path_properties = common::filesystem::absolute_path(path_properties);
     m_properties.insert({string("property-file"), abs_path_properties});
@@ -115,6 +119,7 @@ GraphalyticsReader::GraphalyticsReader(const std::string& path_properties, uint6
     // check that the key vertex-file, edge-file and directed are present
     if(m_properties.find("vertex-file") == m_properties.end()) ERROR("The property `vertex-file' is not set in the property file");
     if(m_properties.find("edge-file") == m_properties.end()) ERROR("The property `edge-file' is not set in the property file");
+    m_weight_generator.set_symmetric(!m_directed);
     COUT_DEBUG("vertex-file: " << get_path_vertex_list() << ", edge-file: " << get_path_edge_list() << ", is_directed: " << is_directed() << ", is_weighted: " << is_weighted());
 
 }
@@ -159,9 +164,21 @@ void GraphalyticsReader::set_emit_directed_edges(bool value){
     m_emit_directed_edges = value;
 }
 
+void GraphalyticsReader::set_snapshot(bool value){
+    m_use_snapshot = value;
+}
+
 void GraphalyticsReader::set_max_weight(double value) {
-    if(value <= 0) INVALID_ARGUMENT("Expected a positive value: " << value);
-    m_max_weight = value;
+    m_weight_generator.set_max_weight(value);
+}
+
+void GraphalyticsReader::set_projection(uint32_t columns){
+    if((columns & ~Column::ALL) != 0) INVALID_ARGUMENT("Invalid set of columns: " << columns);
+    m_projection = columns;
+}
+
+uint32_t GraphalyticsReader::get_projection() const {
+    return m_projection;
 }
 
 /*****************************************************************************
@@ -170,10 +187,114 @@ void GraphalyticsReader::set_max_weight(double value) {
  *                                                                           *
  *****************************************************************************/
 
+namespace {
+
+/**
+ * Read a text file one line at the time, through a private buffer. The lines are returned in place, inside the
+ * buffer, and are valid until the next invocation of next_line.
+ */
+class LineReader {
+    int m_fd; // file descriptor
+    unique_ptr<char[]> m_buffer; // the content read from the file
+    uint64_t m_capacity; // the size of the buffer, in bytes
+    uint64_t m_start = 0; // the position of the next line in the buffer
+    uint64_t m_end = 0; // the amount of valid bytes in the buffer
+    bool m_eof = false; // whether we have read the whole file
+
+    // Read more content from the file, preserving the bytes in [m_start, m_end)
+    void fill(){
+        assert(!m_eof);
+        uint64_t remaining = m_end - m_start;
+        if(m_start > 0){
+            memmove(m_buffer.get(), m_buffer.get() + m_start, remaining);
+            m_start = 0; m_end = remaining;
+        }
+        if(m_end +1 >= m_capacity){ // the current line does not fit the buffer
+            unique_ptr<char[]> buffer { new char[m_capacity * 2] };
+            memcpy(buffer.get(), m_buffer.get(), m_end);
+            m_buffer = move(buffer);
+            m_capacity *= 2;
+        }
+
+        ssize_t bytes_read = 0;
+        do {
+            bytes_read = ::read(m_fd, m_buffer.get() + m_end, m_capacity - m_end -1 /* space for the null terminator */);
+        } while(bytes_read < 0 && errno == EINTR);
+        if(bytes_read < 0) ERROR("Cannot read from the input file: " << strerror(errno));
+        m_end += bytes_read;
+        m_eof = (bytes_read == 0);
+    }
+
+public:
+    LineReader(const string& path, uint64_t buffer_sz = (1ull << 22)) : m_buffer(new char[buffer_sz]), m_capacity(buffer_sz) {
+        m_fd = ::open(path.c_str(), O_RDONLY);
+        if(m_fd < 0) ERROR("Cannot open the file `" << path << "': " << strerror(errno));
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    ~LineReader(){
+        ::close(m_fd);
+    }
+
+    // Retrieve the next line, terminated by '\0' rather than '\n'. Return false when the end of the file has been reached
+    bool next_line(char*& out_line){
+        char* newline = nullptr;
+        while( (newline = reinterpret_cast<char*>(memchr(m_buffer.get() + m_start, '\n', m_end - m_start))) == nullptr ){
+            if(m_eof){ // last line, without the trailing newline
+                if(m_start == m_end) return false;
+                newline = m_buffer.get() + m_end; // there is always space for the null terminator
+                m_end++;
+                break;
+            }
+            fill();
+        }
+
+        newline[0] = '\0';
+        out_line = m_buffer.get() + m_start;
+        m_start = (newline - m_buffer.get()) +1;
+        return true;
+    }
+};
+
+/**
+ * Store the edges read into separate arrays, one for each column
+ */
+template<bool with_weights>
+struct ColumnSink {
+    constexpr static bool is_columnar = true;
+    constexpr static bool has_weights = with_weights;
+    uint64_t* m_sources;
+    uint64_t* m_destinations;
+    double* m_weights;
+
+    void set(uint64_t i, uint64_t source, uint64_t destination, double weight){
+        m_sources[i] = source;
+        m_destinations[i] = destination;
+        if constexpr(with_weights){ m_weights[i] = weight; }
+    }
+};
+
+/**
+ * Store the edges read into an array of records
+ */
+template<typename E>
+struct RecordSink {
+    constexpr static bool is_columnar = false;
+    constexpr static bool has_weights = !is_same_v<E, Edge>;
+    E* m_edges;
+
+    void set(uint64_t i, uint64_t source, uint64_t destination, double weight){
+        m_edges[i].m_source = source;
+        m_edges[i].m_destination = destination;
+        if constexpr(has_weights){ m_edges[i].m_weight = weight; }
+    }
+};
+
+} // anon namespace
+
 static void handle_close(void*& ptr_handle){
     if(ptr_handle == nullptr) return; // nop
-    auto handle = reinterpret_cast<fstream*>(ptr_handle);
-    handle->close();
+    auto handle = reinterpret_cast<LineReader*>(ptr_handle);
     delete handle;
     ptr_handle = nullptr;
 }
@@ -188,6 +309,41 @@ void GraphalyticsReader::reset(){
     // read_edge and read_vertex are going to reinit the handle if they are called again
     close();
     m_last_reported = true;
+    m_snapshot_position = 0;
+}
+
+void GraphalyticsReader::reset_vertices(){
+    handle_close(m_handle_vertex_file);
+}
+
+void GraphalyticsReader::open_snapshot(){
+    const string path_edge_file = get_path_edge_list();
+    m_snapshot = EdgeSnapshot::open(path_edge_file, is_weighted());
+    if(m_snapshot) return;
+
+    unique_ptr<EdgeSnapshotWriter> writer;
+    try {
+        writer.reset(new EdgeSnapshotWriter(path_edge_file, is_weighted()));
+    } catch(common::Error& e){ // e.g. the directory of the input graph is read only
+        cout << "[GraphalyticsReader] Warning, cannot create the snapshot of the edge file, parsing the text: " << e.what() << endl;
+        m_use_snapshot = false;
+        return;
+    }
+
+    // parse the whole edge file, with all columns, as the same snapshot serves any projection
+    cout << "[GraphalyticsReader] Creating the snapshot " << EdgeSnapshot::path(path_edge_file) << " ..." << endl;
+    LineReader handle { path_edge_file };
+    char* line = nullptr;
+    uint64_t source = 0, destination = 0; double weight = 0;
+    while(handle.next_line(line)){
+        bool is_edge = is_weighted() ? parse_edge<WeightMode::PARSE>(line, Column::ALL, source, destination, weight) :
+                parse_edge<WeightMode::NONE>(line, Column::ALL, source, destination, weight);
+        if(is_edge){ writer->append(source, destination, weight); }
+    }
+    writer->commit();
+
+    m_snapshot = EdgeSnapshot::open(path_edge_file, is_weighted());
+    if(!m_snapshot) ERROR("Cannot open the snapshot " << EdgeSnapshot::path(path_edge_file) << " just created");
 }
 
 /*****************************************************************************
@@ -201,98 +357,207 @@ bool GraphalyticsReader::read(uint64_t& out_source, uint64_t& out_destination, d
 }
 
 bool GraphalyticsReader::read_edge(uint64_t& out_source, uint64_t& out_destination, double& out_weight){
+    return read_edges(&out_source, &out_destination, &out_weight, 1) == 1;
+}
+
+uint64_t GraphalyticsReader::read_edges(uint64_t* out_sources, uint64_t* out_destinations, double* out_weights, uint64_t capacity){
+    if(out_sources == nullptr || out_destinations == nullptr) INVALID_ARGUMENT("The arrays for the sources and the destinations are mandatory");
+    if(out_weights == nullptr){
+        if(m_projection & Column::WEIGHT) INVALID_ARGUMENT("The array for the weights is mandatory when the column WEIGHT is selected");
+        ColumnSink<false> sink { out_sources, out_destinations, nullptr };
+        return read_edges_impl(sink, capacity);
+    } else {
+        ColumnSink<true> sink { out_sources, out_destinations, out_weights };
+        return read_edges_impl(sink, capacity);
+    }
+}
+
+uint64_t GraphalyticsReader::read_edges(Edge* out_edges, uint64_t capacity){
+    RecordSink<Edge> sink { out_edges };
+    return read_edges_impl(sink, capacity);
+}
+
+uint64_t GraphalyticsReader::read_edges(WeightedEdge* out_edges, uint64_t capacity){
+    RecordSink<WeightedEdge> sink { out_edges };
+    return read_edges_impl(sink, capacity);
+}
+
+uint64_t GraphalyticsReader::read_edges(CompactWeightedEdge* out_edges, uint64_t capacity){
+    RecordSink<CompactWeightedEdge> sink { out_edges };
+    return read_edges_impl(sink, capacity);
+}
+
+template<typename Sink>
+uint64_t GraphalyticsReader::read_edges_impl(Sink& sink, uint64_t capacity){
+    // resolve the properties of the batch once, rather than for each edge
+    bool emit_swapped = !is_directed() && m_emit_directed_edges;
+    WeightMode weight_mode = WeightMode::NONE;
+    if(Sink::has_weights && (m_projection & Column::WEIGHT)){
+        weight_mode = is_weighted() ? WeightMode::PARSE : WeightMode::GENERATE;
+    }
+
+    if(emit_swapped){
+        switch(weight_mode){
+        case WeightMode::NONE: return read_edges_impl<WeightMode::NONE, true>(sink, capacity);
+        case WeightMode::PARSE: return read_edges_impl<WeightMode::PARSE, true>(sink, capacity);
+        case WeightMode::GENERATE: return read_edges_impl<WeightMode::GENERATE, true>(sink, capacity);
+        }
+    } else {
+        switch(weight_mode){
+        case WeightMode::NONE: return read_edges_impl<WeightMode::NONE, false>(sink, capacity);
+        case WeightMode::PARSE: return read_edges_impl<WeightMode::PARSE, false>(sink, capacity);
+        case WeightMode::GENERATE: return read_edges_impl<WeightMode::GENERATE, false>(sink, capacity);
+        }
+    }
+
+    assert(0 && "Unreachable");
+    return 0;
+}
+
+template<GraphalyticsReader::WeightMode weight_mode, bool emit_swapped, typename Sink>
+uint64_t GraphalyticsReader::read_edges_impl(Sink& sink, uint64_t capacity){
+    if(m_use_snapshot && !m_snapshot){ open_snapshot(); }
+
+    if(m_snapshot){ // binary snapshot, the edges are already parsed
+        const EdgeSnapshot* snapshot = m_snapshot.get();
+        return fill_edges<weight_mode, emit_swapped>(sink, capacity, [&](uint64_t& source, uint64_t& destination, double& weight){
+            if(m_snapshot_position >= snapshot->num_edges()) return false;
+            snapshot->get(m_snapshot_position++, source, destination, weight);
+            return true;
+        });
+    }
+
     if(m_handle_edge_file == nullptr) {
         COUT_DEBUG("Opening the input stream `" << get_path_edge_list() << "'");
-        m_handle_edge_file = new fstream(get_path_edge_list());
+        m_handle_edge_file = new LineReader(get_path_edge_list());
     }
-    fstream* handle = reinterpret_cast<fstream*>(m_handle_edge_file);
+    LineReader* handle = reinterpret_cast<LineReader*>(m_handle_edge_file);
     assert(handle != nullptr && "Null pointer");
 
-    if(!is_directed() && m_emit_directed_edges && !m_last_reported){
-        std::swap(m_last_source, m_last_destination);
-        m_last_reported = true;
-    } else {
-        if(!handle->good()) return false;
+    // both the swapped edges and the generated weights require the endpoints
+    uint32_t columns = m_projection;
+    if(emit_swapped || weight_mode == WeightMode::GENERATE){
+        columns |= Column::SOURCE | Column::DESTINATION;
+    }
 
-        // read the next line that is not a comment
-        string current_line;
-        bool skip { true } ;
-        do {
-            getline(*handle, current_line);
+    return fill_edges<weight_mode, emit_swapped>(sink, capacity, [&](uint64_t& source, uint64_t& destination, double& weight){
+        char* line = nullptr;
+        while(handle->next_line(line)){
+            if(parse_edge<weight_mode>(line, columns, source, destination, weight)) return true;
+            // else, comment or empty line
+        }
+        return false;
+    });
+}
 
-            skip = ignore_line(current_line);
-#if defined(DEBUG)
-            if(skip) { COUT_DEBUG("line: `" << current_line << "' is a comment or an empty line, skipped"); }
-#endif
-        } while (skip && handle->good());
-        if(skip) return false; // ended with a comment
-        COUT_DEBUG("Parse line: `" << current_line << "'");
+template<GraphalyticsReader::WeightMode weight_mode, bool emit_swapped, typename Sink, typename Next>
+uint64_t GraphalyticsReader::fill_edges(Sink& sink, uint64_t capacity, Next next){
+    // with a columnar layout, generate the weights for the whole batch at the end
+    constexpr bool generate_each_edge = (weight_mode == WeightMode::GENERATE) && !Sink::is_columnar;
+    constexpr bool generate_batch = (weight_mode == WeightMode::GENERATE) && Sink::is_columnar;
 
-        // read the source
-        char* next { nullptr };
-        const char* current = current_line.c_str();
-        while(isspace(current[0])) current++;
-        if(!is_number(current)) ERROR("line: `" << current_line << "', cannot read the source vertex");
-        m_last_source = strtoull(current, &next, /* base */ 10);
+    uint64_t num_edges = 0;
+    if(emit_swapped && !m_last_reported && capacity > 0){ // complete the edge from the last invocation
+        sink.set(num_edges++, m_last_destination, m_last_source, m_last_weight);
+        m_last_reported = true;
+    }
 
-        while(isspace(next[0])) next++;
-        current = next;
-        if(!is_number(current)) ERROR("line: `" << current_line << "', cannot read the destination vertex");
-        m_last_destination = strtoull(current, &next, 10);
-
-        if(is_weighted()){
-            while(isspace(next[0])) next++;
-            current = next;
-            if(!is_number(current)) ERROR("line: `" << current_line << "', cannot read the weight");
-            m_last_weight = strtod(current, nullptr);
-        } else {
-            m_last_weight = uniform_real_distribution<double>{0, m_max_weight}(m_random_generator); // generates a value in [a, b)
-            if(m_last_weight == 0.0) m_last_weight = m_max_weight; // shift it to (a, b]
+    uint64_t source = 0, destination = 0; double weight = 0;
+    while(num_edges < capacity && next(source, destination, weight)){
+        if constexpr(generate_each_edge){ weight = m_weight_generator(source, destination); }
+        COUT_DEBUG("edge parsed: " << source << " -> " << destination << ", weight: " << weight);
+
+        sink.set(num_edges++, source, destination, weight);
+        if(emit_swapped){
+            if(num_edges < capacity){
+                sink.set(num_edges++, destination, source, weight);
+            } else { // report it in the next invocation
+                m_last_source = source;
+                m_last_destination = destination;
+                m_last_weight = generate_batch ? m_weight_generator(source, destination) : weight;
+                m_last_reported = false;
+            }
         }
+    }
 
-        m_last_reported = false;
+    if constexpr(generate_batch){ // the generator is symmetric for undirected graphs, the swapped edges obtain the same weight
+        m_weight_generator.generate(sink.m_sources, sink.m_destinations, sink.m_weights, num_edges);
     }
 
-    out_source = m_last_source;
-    out_destination = m_last_destination;
-    out_weight = m_last_weight;
-    COUT_DEBUG("edge parsed: " << out_source << " -> " << out_destination << ", weight: " << out_weight);
+    return num_edges;
+}
+
+template<GraphalyticsReader::WeightMode weight_mode>
+bool GraphalyticsReader::parse_edge(char* line, uint32_t columns, uint64_t& out_source, uint64_t& out_destination, double& out_weight){
+    if(ignore_line(line)){
+        COUT_DEBUG("line: `" << line << "' is a comment or an empty line, skipped");
+        return false;
+    }
+    COUT_DEBUG("Parse line: `" << line << "'");
+
+    // read the source
+    char* next { nullptr };
+    const char* current = line;
+    while(isspace(current[0])) current++;
+    if(!is_number(current)) ERROR("line: `" << line << "', cannot read the source vertex");
+    if(columns & Column::SOURCE){
+        out_source = strtoull(current, &next, /* base */ 10);
+    } else {
+        out_source = 0;
+        next = skip_number(current);
+    }
+
+    while(isspace(next[0])) next++;
+    current = next;
+    if(!is_number(current)) ERROR("line: `" << line << "', cannot read the destination vertex");
+    if(columns & Column::DESTINATION){
+        out_destination = strtoull(current, &next, 10);
+    } else {
+        out_destination = 0;
+        next = skip_number(current);
+    }
+
+    if(weight_mode == WeightMode::PARSE){
+        while(isspace(next[0])) next++;
+        current = next;
+        if(!is_number(current)) ERROR("line: `" << line << "', cannot read the weight");
+        out_weight = strtod(current, nullptr);
+    } else {
+        out_weight = 0; // either not requested or generated afterwards
+    }
 
     return true;
 }
 
 bool GraphalyticsReader::read_vertex(uint64_t& out_vertex){
     out_vertex = 0; // init
+    return read_vertices(&out_vertex, 1) == 1;
+}
 
+uint64_t GraphalyticsReader::read_vertices(uint64_t* out_vertices, uint64_t capacity){
     if(m_handle_vertex_file == nullptr) {
         COUT_DEBUG("Opening the input stream `" << get_path_vertex_list() << "'");
-        m_handle_vertex_file = new fstream(get_path_vertex_list());
+        m_handle_vertex_file = new LineReader(get_path_vertex_list());
     }
-    fstream* handle = reinterpret_cast<fstream*>(m_handle_vertex_file);
+    LineReader* handle = reinterpret_cast<LineReader*>(m_handle_vertex_file);
     assert(handle != nullptr && "Null pointer");
 
-    if(!handle->good()) return false;
-
-    // read the next line that is not a comment
-    string current_line;
-    bool skip { true } ;
-    do {
-        getline(*handle, current_line);
-
-        skip = ignore_line(current_line);
-#if defined(DEBUG)
-      if(skip) { COUT_DEBUG("line: `" << current_line << "' is a comment or an empty line, skipped"); }
-#endif
-    } while (skip && handle->good());
-    if(skip) return false; // ended with a comment
-    COUT_DEBUG("Parse line: `" << current_line << "'");
+    uint64_t num_vertices = 0;
+    char* line = nullptr;
+    while(num_vertices < capacity && handle->next_line(line)){
+        if(ignore_line(line)){
+            COUT_DEBUG("line: `" << line << "' is a comment or an empty line, skipped");
+            continue;
+        }
+        COUT_DEBUG("Parse line: `" << line << "'");
 
-    const char* current = current_line.c_str();
-    while(isspace(current[0])) current++;
-    if(!is_number(current)) ERROR("line: `" << current_line << "', cannot read the vertex id");
-    out_vertex = strtoull(current, nullptr, /* base */ 10);
+        const char* current = line;
+        while(isspace(current[0])) current++;
+        if(!is_number(current)) ERROR("line: `" << line << "', cannot read the vertex id");
+        out_vertices[num_vertices++] = strtoull(current, nullptr, /* base */ 10);
+    }
 
-    return true;
+    return num_vertices;
 }
 
 bool GraphalyticsReader::ignore_line(const char* line){
@@ -307,4 +572,9 @@ bool GraphalyticsReader::ignore_line(const std::string& line){
 
 bool GraphalyticsReader::is_number(const char* marker){
     return marker != nullptr && (marker[0] >= '0' && marker[0] <= '9');
+}
+
+char* GraphalyticsReader::skip_number(const char* marker){
+    while(is_number(marker)) marker++;
+    return const_cast<char*>(marker);
 }
\ No newline at end of file
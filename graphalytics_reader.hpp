@@ -17,10 +17,14 @@
 
 #pragma once
 
+#include <memory>
 #include <random>
 #include <unordered_map>
 
 #include "lib/common/error.hpp"
+#include "edge.hpp"
+#include "edge_snapshot.hpp"
+#include "weight.hpp"
 
 /**
  * An exception raised by the reader while parsing the input files
@@ -33,20 +37,41 @@ DEFINE_EXCEPTION(ReaderError);
  * derived from the parameters inside the property file.
  */
 class GraphalyticsReader {
+public:
+    /**
+     * The columns of the edge list, to select which fields the reader should produce
+     */
+    enum Column : uint32_t {
+        SOURCE = 0x1,
+        DESTINATION = 0x2,
+        WEIGHT = 0x4,
+        ALL = SOURCE | DESTINATION | WEIGHT,
+    };
+
+private:
+    // How to obtain the weights of the edges
+    enum class WeightMode { NONE, PARSE, GENERATE };
+
     std::unordered_map<std::string, std::string> m_properties; // property file
     bool m_directed = true; // whether the graph being processed is directed or not
     bool m_is_weighted = false; // whether the graph being processed contains weights or not
-    void* m_handle_edge_file { nullptr }; // fstream, handle to parse the edge-file
-    void* m_handle_vertex_file { nullptr }; // fstream, handle to parse the vertex-file
+    void* m_handle_edge_file { nullptr }; // LineReader, handle to parse the edge-file
+    void* m_handle_vertex_file { nullptr }; // LineReader, handle to parse the vertex-file
+    bool m_use_snapshot = false; // whether to read the edges from a binary snapshot of the edge file, creating it if needed
+    std::unique_ptr<EdgeSnapshot> m_snapshot; // the snapshot of the edge file, once opened
+    uint64_t m_snapshot_position = 0; // the next edge to read from the snapshot
     uint64_t m_last_source {0}; uint64_t m_last_destination {0}; double m_last_weight{0.0}; // the last edge being parsed
     bool m_last_reported = true; // whether we have reported the last edge with source/dest vertices swapped in an undirected graph
     bool m_emit_directed_edges = false; // if the graph is undirected, report the same edge twice as src -> dest and dest -> src
-    double m_max_weight = 1.0; // the maximum weight to generate when operating on non weighted graph
-    std::mt19937 m_random_generator; // generator for the weights
+    uint32_t m_projection = Column::ALL; // the columns requested by the caller, the others are neither parsed nor generated
+    WeightGenerator m_weight_generator; // generator for the weights, when operating on non weighted graphs
 
     // Close the internal handles to parse the edge-file/vertex-file
     void close();
 
+    // Open the snapshot of the edge file, creating it if it does not exist or it is not valid any more
+    void open_snapshot();
+
     /**
      * Check whether the given line is a comment or empty, that is, it starts with a sharp symbol # or contains no symbols
      */
@@ -58,6 +83,33 @@ class GraphalyticsReader {
      */
     static bool is_number(const char* marker);
 
+    /**
+     * Move the marker past the digits of the current number
+     */
+    static char* skip_number(const char* marker);
+
+    /**
+     * Parse the edge in the given line, restricted to the given columns. Return false if the line is a comment
+     */
+    template<WeightMode weight_mode>
+    static bool parse_edge(char* line, uint32_t columns, uint64_t& out_source, uint64_t& out_destination, double& out_weight);
+
+    /**
+     * Fill the given sink with the next edges, up to `capacity'. The first overload selects the specialisation for
+     * the properties of the graph, so that they are evaluated only once per batch.
+     */
+    template<typename Sink>
+    uint64_t read_edges_impl(Sink& sink, uint64_t capacity);
+    template<WeightMode weight_mode, bool emit_swapped, typename Sink>
+    uint64_t read_edges_impl(Sink& sink, uint64_t capacity);
+
+    /**
+     * Fill the sink with the edges fetched by `next', either from the text file or from the snapshot, emitting the
+     * swapped edges and generating the weights when required
+     */
+    template<WeightMode weight_mode, bool emit_swapped, typename Sink, typename Next>
+    uint64_t fill_edges(Sink& sink, uint64_t capacity, Next next);
+
 public:
     /**
      * Init the reader with the path to the graph property files (*.properties)
@@ -79,16 +131,43 @@ public:
      */
     bool read_edge(uint64_t& out_source, uint64_t& out_destination, double& out_weight);
 
+    /**
+     * Read the next batch of edges in a columnar layout, up to `capacity' edges, into the arrays provided by the caller.
+     * The array for the weights can be a nullptr when the column WEIGHT is not selected in the projection.
+     * Return the number of edges read, or 0 when the whole edge list has been consumed.
+     */
+    uint64_t read_edges(uint64_t* out_sources, uint64_t* out_destinations, double* out_weights, uint64_t capacity);
+
+    /**
+     * Read the next batch of edges in an array of records, up to `capacity' edges. Return the number of edges read,
+     * or 0 when the whole edge list has been consumed.
+     */
+    uint64_t read_edges(Edge* out_edges, uint64_t capacity);
+    uint64_t read_edges(WeightedEdge* out_edges, uint64_t capacity);
+    uint64_t read_edges(CompactWeightedEdge* out_edges, uint64_t capacity);
+
     /**
      * Iterator, read one vertex at the time from the graph
      */
     bool read_vertex(uint64_t& out_vertex);
 
+    /**
+     * Read the next batch of vertices, up to `capacity'. Return the number of vertices read, or 0 when the whole
+     * vertex list has been consumed.
+     */
+    uint64_t read_vertices(uint64_t* out_vertices, uint64_t capacity);
+
     /**
      * Reset the position of the iterators read/read_edge/read_vertex at the start of the file
      */
     void reset();
 
+    /**
+     * Reset the position of read_vertex/read_vertices at the start of the vertex file, without affecting the edge
+     * file. The vertex file can be read by a different thread than the edge file.
+     */
+    void reset_vertices();
+
     // Retrieve the given property from the map, or the empty string if the property is not present
     std::string get_property(const std::string& key) const;
 
@@ -117,8 +196,27 @@ public:
      */
     void set_emit_directed_edges(bool value);
 
+    /**
+     * Read the edges from a binary snapshot of the edge file, stored next to it, rather than parsing the text. The
+     * snapshot is created in the first read when it does not exist or the edge file has changed.
+     */
+    void set_snapshot(bool value);
+
     /**
      * Set the max weight that can be generated when reading non weighted graphs
      */
      void set_max_weight(double value);
+
+    /**
+     * Select the columns to report in read/read_edge, as a bitmask of Column. The fields not requested are neither
+     * parsed nor generated and their value is unspecified, e.g. the weights are not generated when only
+     * SOURCE | DESTINATION are requested. The endpoints are still parsed when they are required to generate the
+     * weights or to emit the edges of undirected graphs in both directions.
+     */
+    void set_projection(uint32_t columns);
+
+    /**
+     * Retrieve the columns reported by read/read_edge
+     */
+    uint32_t get_projection() const;
 };
\ No newline at end of file
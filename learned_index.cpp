@@ -0,0 +1,174 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "learned_index.hpp"
+
+#include <algorithm>
+
+#include "memory_policy.hpp"
+
+using namespace std;
+
+LearnedIndex::LearnedIndex(uint64_t num_keys) : m_num_keys(num_keys) {
+    m_keys = static_cast<uint64_t*>(map_memory(max<uint64_t>(1, m_num_keys) * sizeof(uint64_t)));
+}
+
+LearnedIndex::~LearnedIndex(){
+    unmap_memory(m_keys, max<uint64_t>(1, m_num_keys) * sizeof(uint64_t));
+}
+
+void LearnedIndex::build(){
+    build_segments();
+    build_radix_table();
+}
+
+void LearnedIndex::build_segments(){
+    const double epsilon = s_epsilon;
+    m_segments.clear();
+
+    uint64_t i = 0;
+    while(i < m_num_keys){
+        Segment segment { m_keys[i], i, 0 };
+
+        // the cone of the slopes such that all points of the segment are within epsilon from the prediction
+        double slope_min = 0;
+        double slope_max = numeric_limits<double>::infinity();
+        uint64_t j = i +1;
+        while(j < m_num_keys){
+            double dx = m_keys[j] - segment.m_key;
+            double dy = j - i;
+            double lo = max(slope_min, (dy - epsilon) / dx);
+            double hi = min(slope_max, (dy + epsilon) / dx);
+            if(lo > hi) break; // the point falls outside the cone, start a new segment
+            slope_min = lo;
+            slope_max = hi;
+            j++;
+        }
+        if(j > i +1){ segment.m_slope = (slope_min + slope_max) / 2; }
+
+        m_segments.push_back(segment);
+        i = j;
+    }
+
+    m_segments.push_back(Segment{ numeric_limits<uint64_t>::max(), m_num_keys, 0 }); // sentinel
+}
+
+void LearnedIndex::build_radix_table(){
+    m_radix_table.clear();
+    if(m_num_keys == 0) return;
+
+    // about two entries per segment, up to 2^s_max_radix_bits
+    uint64_t num_bits = 1;
+    while(num_bits < s_max_radix_bits && (1ull << num_bits) < 2 * num_segments()){ num_bits++; }
+    const uint64_t range = m_keys[m_num_keys -1] - m_keys[0];
+    const uint64_t range_bits = range == 0 ? 0 : 64 - __builtin_clzll(range);
+    m_radix_shift = range_bits > num_bits ? range_bits - num_bits : 0;
+
+    const uint64_t num_prefixes = (range >> m_radix_shift) +1;
+    m_radix_table.resize(num_prefixes +1);
+    uint64_t segment_id = 0;
+    for(uint64_t prefix = 0; prefix <= num_prefixes; prefix++){
+        while(segment_id < num_segments() && ((m_segments[segment_id].m_key - m_keys[0]) >> m_radix_shift) < prefix){
+            segment_id++;
+        }
+        m_radix_table[prefix] = segment_id;
+    }
+}
+
+void LearnedIndex::window(uint64_t key, uint64_t& first, uint64_t& last) const {
+    // the candidate segments, from the radix table
+    const uint64_t prefix = (key - m_keys[0]) >> m_radix_shift;
+    uint64_t begin = m_radix_table[prefix];
+    uint64_t end = m_radix_table[prefix +1];
+    if(begin > 0){ begin--; } // the last segment of the previous prefix may contain the key
+
+    // the last segment with a first key <= key. There are usually one or two candidates, scan them in order
+    const Segment* segment = nullptr;
+    if(end - begin <= 8){
+        segment = m_segments.data() + begin;
+        while(segment[1].m_key <= key){ segment++; } // stops at the sentinel, at the latest
+    } else {
+        segment = upper_bound(m_segments.data() + begin, m_segments.data() + end, key,
+                [](uint64_t key, const Segment& segment){ return key < segment.m_key; }) -1;
+    }
+    const Segment* next = segment +1;
+
+    // the window around the prediction, clamped to the positions of the segment. The cone is computed in floating
+    // point, allow one more position on each side for the rounding errors
+    double prediction = segment->m_position + segment->m_slope * (key - segment->m_key);
+    uint64_t position = prediction >= next->m_position ? next->m_position : static_cast<uint64_t>(prediction);
+    first = max(segment->m_position + s_epsilon +1, position) - s_epsilon -1;
+    last = min(next->m_position, position + s_epsilon +2);
+}
+
+uint64_t LearnedIndex::search(uint64_t key, uint64_t first, uint64_t last) const {
+    // branch free binary search of the last key <= key
+    const uint64_t* base = m_keys + first;
+    uint64_t n = last - first;
+    if(n == 0) return NOT_FOUND;
+    while(n > 1){
+        uint64_t half = n / 2;
+        base = (base[half] <= key) ? base + half : base;
+        n -= half;
+    }
+    return *base == key ? base - m_keys : NOT_FOUND;
+}
+
+uint64_t LearnedIndex::search_all(uint64_t key) const {
+    const uint64_t* it = lower_bound(m_keys, m_keys + m_num_keys, key);
+    return (it != m_keys + m_num_keys && *it == key) ? it - m_keys : NOT_FOUND;
+}
+
+uint64_t LearnedIndex::find(uint64_t key) const {
+    if(m_num_keys == 0 || key < m_keys[0] || key > m_keys[m_num_keys -1]) return NOT_FOUND;
+    uint64_t first = 0, last = 0;
+    window(key, first, last);
+    uint64_t result = search(key, first, last);
+    return result != NOT_FOUND ? result : search_all(key);
+}
+
+void LearnedIndex::find(const uint64_t* keys, uint64_t* positions, uint64_t num_keys) const {
+    uint64_t first[s_group_size];
+    uint64_t last[s_group_size];
+
+    for(uint64_t start = 0; start < num_keys; start += s_group_size){
+        const uint64_t group_size = min(s_group_size, num_keys - start);
+
+        // compute the windows of the group and prefetch their middle point, the first probe of the search
+        for(uint64_t i = 0; i < group_size; i++){
+            uint64_t key = keys[start + i];
+            if(m_num_keys == 0 || key < m_keys[0] || key > m_keys[m_num_keys -1]){
+                first[i] = last[i] = 0; // empty window
+            } else {
+                window(key, first[i], last[i]);
+                __builtin_prefetch(m_keys + (first[i] + last[i]) / 2);
+            }
+        }
+
+        // complete the searches
+        for(uint64_t i = 0; i < group_size; i++){
+            uint64_t key = keys[start + i];
+            uint64_t result = search(key, first[i], last[i]);
+            if(result == NOT_FOUND && first[i] < last[i]){ result = search_all(key); }
+            positions[start + i] = result;
+        }
+    }
+}
+
+uint64_t LearnedIndex::footprint() const {
+    return m_num_keys * sizeof(uint64_t) + m_segments.size() * sizeof(Segment) + m_radix_table.size() * sizeof(uint64_t);
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * A learned index over a sorted array of distinct keys, to find the position of a key. The array is approximated by a
+ * piecewise linear function, computed in a single pass with the shrinking cone algorithm (A. Galakatos et al.,
+ * FITing-Tree, SIGMOD 2019): the position predicted for any key of the array is at most s_epsilon away from the
+ * actual position. A radix table over the most significant bits of the keys narrows down the segment of a key to a
+ * few candidates (A. Kipf et al., RadixSpline, aiDM 2020), the last mile is a branch free binary search in the window
+ * around the prediction.
+ *
+ * Lookups in batch first compute the predictions of a group of keys and prefetch their windows, then complete the
+ * searches, to overlap the cache misses of the group.
+ *
+ * Memory: the array of keys, 8 bytes per key, plus the segments and the radix table, which are usually much smaller.
+ * Store all keys with #set(), in increasing order, then invoke #build() before the first lookup.
+ */
+class LearnedIndex {
+    LearnedIndex(const LearnedIndex&) = delete;
+    LearnedIndex& operator=(const LearnedIndex&) = delete;
+
+    static constexpr uint64_t s_epsilon = 8; // max error of the predicted position
+    static constexpr uint64_t s_group_size = 16; // number of keys in flight in a batch lookup
+    static constexpr uint64_t s_max_radix_bits = 20; // max size of the radix table, 2^20 entries
+
+    struct Segment {
+        uint64_t m_key; // the first key of the segment
+        uint64_t m_position; // the position of the first key
+        double m_slope; // position = m_position + m_slope * (key - m_key)
+    };
+
+    uint64_t* m_keys = nullptr; // the sorted array
+    const uint64_t m_num_keys; // size of the array
+    std::vector<Segment> m_segments; // the piecewise linear function, plus a sentinel at the end
+    std::vector<uint64_t> m_radix_table; // for each prefix of the keys, the first segment with that prefix or greater
+    uint64_t m_radix_shift = 0; // (key - min) >> m_radix_shift is the prefix of the key
+
+    // the range of positions [first, last) where to search the given key
+    void window(uint64_t key, uint64_t& first, uint64_t& last) const;
+
+    // find the key in the range of positions [first, last)
+    uint64_t search(uint64_t key, uint64_t first, uint64_t last) const;
+
+    // find the key in the whole array, only invoked when the key is not in its window
+    uint64_t search_all(uint64_t key) const;
+
+    // compute the segments
+    void build_segments();
+
+    // compute the radix table
+    void build_radix_table();
+
+public:
+    static constexpr uint64_t NOT_FOUND = std::numeric_limits<uint64_t>::max(); // result of a lookup for a missing key
+
+    /**
+     * Create an index for `num_keys' keys
+     */
+    LearnedIndex(uint64_t num_keys);
+
+    /**
+     * Release the array and the index
+     */
+    ~LearnedIndex();
+
+    /**
+     * Store the key at the given position of the array
+     */
+    void set(uint64_t position, uint64_t key){
+        assert(position < m_num_keys && "Out of bounds");
+        assert((position == 0 || m_keys[position -1] < key) && "The keys must be sorted and distinct");
+        m_keys[position] = key;
+    }
+
+    /**
+     * Compute the model, once all keys have been stored
+     */
+    void build();
+
+    /**
+     * The position of the key in the array, or NOT_FOUND if the key does not exist
+     */
+    uint64_t find(uint64_t key) const;
+
+    /**
+     * Find the positions of the given keys, in batch. Missing keys are reported as NOT_FOUND.
+     */
+    void find(const uint64_t* keys, uint64_t* positions, uint64_t num_keys) const;
+
+    /**
+     * Number of keys in the array
+     */
+    uint64_t size() const { return m_num_keys; }
+
+    /**
+     * Number of segments of the model
+     */
+    uint64_t num_segments() const { return m_segments.empty() ? 0 : m_segments.size() -1; }
+
+    /**
+     * Amount of memory used by the array and the model, in bytes
+     */
+    uint64_t footprint() const;
+};
@@ -1,11 +1,13 @@
 #include <algorithm>
 #include <cassert>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <malloc.h>
 #include <mutex>
 #include <regex>
+#include <sstream>
 #include <thread>
-#include <unordered_map>
 #include <utility>
 
 #include "lib/common/error.hpp"
@@ -13,58 +15,104 @@
 #include "lib/common/system.hpp"
 #include "lib/common/timer.hpp"
 #include "lib/cxxopts.hpp"
-#include "zlib.h"
 
+#include "async_writer.hpp"
+#include "batch.hpp"
 #include "edge.hpp"
 #include "graphalytics_algorithms.hpp"
 #include "graphalytics_reader.hpp"
+#include "mapped_vector.hpp"
+#include "memory_policy.hpp"
+#include "perf_counters.hpp"
+#include "overlapped_pipeline.hpp"
+#include "pipeline.hpp"
+#include "report.hpp"
+#include "tracer.hpp"
+#include "weight.hpp"
 
 using namespace common;
 using namespace std;
 
-bool g_compress_output = false; // whether to compress (.zip) the output edges and vertices
+bool g_batch = false; // whether to convert all graphs in the input directory
+BatchSettings g_batch_settings; // the settings of the batch mode
+bool g_parse_cache = false; // whether to read the edges from a binary snapshot of the input, rather than parsing the text
+vector<OutputFormat> g_output_formats; // the formats of the output graph, e.g. plain or zlib, all written in the same run
 string g_path_input; // path to the input graph, in the Graphalytics format
 string g_path_output; // path to the output graph
+string g_path_report; // path to the JSON report with the statistics of each stage, if requested
+string g_path_trace; // path to the timeline of the threads, in the Chrome trace format, if requested
+bool g_sequential = false; // whether to execute the stages one after the other, rather than overlapping them
 bool g_sorted_order_vertices = false; // whether to remap the vertices following the same sorted order of the input
-
-// logging
-#define LOG(msg) { std::scoped_lock xlock_log(g_mutex_log); std::cout << msg << std::endl; }
-mutex g_mutex_log;
+WeightType g_weight_type = WeightType::FLOAT64; // the representation of the weights, in memory and in the output
 
 // function prototypes
 static void parse_command_line_arguments(int argc, char* argv[]);
-static pair<uint64_t, vector<WeightedEdge>> parse_input(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms);
-static void sort_edges(vector<WeightedEdge>& edges);
-static void save_properties(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, const string& path_prefix);
-static void save_vertices(uint64_t num_vertices, const string& path_output);
-static void save_edges(vector<WeightedEdge>& edges, const string& path_output, bool is_weighted);
+template<typename E> static void run(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms);
+template<typename E, bool is_directed> static void run(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms);
+template<typename E, bool is_directed, typename Edges> static void run_sequential(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, const string& prefix, const vector<string>& paths_properties, uint64_t& num_vertices, uint64_t& num_edges, double& rounding_error, double& encoding_error);
+static void save_properties(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, const WeightEncoder& encoder, OutputFormat format, const string& path_prefix, const string& path_properties);
 static string get_current_datetime();
+static string get_output_formats();
 
 int main(int argc, char* argv[]) {
     Timer timer; timer.start();
 
     try {
         parse_command_line_arguments(argc, argv);
+        if(g_batch){ // convert each graph in its own process
+            uint64_t num_failures = run_batch(g_batch_settings);
+            return num_failures == 0 ? 0 : 1;
+        }
 
         // read the input graph
+        ReportStage stage { "parse-properties" };
         GraphalyticsReader reader(g_path_input);
+        reader.set_snapshot(g_parse_cache);
         GraphalyticsAlgorithms algorithms(reader);
-        auto input = parse_input(reader, algorithms);
-        uint64_t num_vertices = input.first;
-        sort_edges(input.second);
-
-        // remove the suffix ".properties" from the end of the file name
-        smatch matches;
-        regex_match(g_path_output, matches, regex{"^(.+?)(\\.properties)?$"});
-        string prefix = matches[1];
-
-        // store the new graph
-        save_properties(reader, algorithms, prefix);
-        string path_vertices = prefix + (g_compress_output ? ".vz" : ".v");
-        save_vertices(num_vertices, path_vertices);
-        string path_edges = prefix + (g_compress_output ? ".ez" : ".e");
-        save_edges(input.second, path_edges, reader.is_weighted());
+        stage->m_bytes_read = file_size(g_path_input);
+        stage.close();
+
+        if(!reader.is_weighted()){ // do not carry the weights at all
+            run<Edge>(reader, algorithms);
+        } else if(is_compact(g_weight_type)){
+            run<CompactWeightedEdge>(reader, algorithms);
+        } else {
+            run<WeightedEdge>(reader, algorithms);
+        }
 
+        timer.stop();
+        if(g_perf.is_enabled()){
+            g_report.set_threads(g_perf.sample_all_threads());
+            cout << "\n";
+            g_report.print_counters(cout);
+        }
+        if(!g_path_report.empty()){
+            g_report.set("input", g_path_input);
+            g_report.set("output", g_path_output);
+            g_report.set("hostname", common::hostname());
+            g_report.set("datetime", get_current_datetime());
+            g_report.set("formats", get_output_formats());
+            g_report.set("compressed", find(begin(g_output_formats), end(g_output_formats), OutputFormat::ZLIB) != end(g_output_formats));
+            g_report.set("stable", g_sorted_order_vertices);
+            g_report.set("cache", g_parse_cache);
+            g_report.set("sequential", g_sequential);
+            g_report.set("low_memory", g_low_memory);
+            g_report.set("sort_threads", g_num_sort_threads);
+            g_report.set("huge_pages", g_memory_policy.m_huge_pages);
+            g_report.set("numa_interleave", g_memory_policy.m_interleave);
+            g_report.set("weights", to_string(g_weight_type));
+            g_report.set("io_depth", g_output_options.m_queue_depth);
+            g_report.set("direct_io", g_output_options.m_direct_io);
+            g_report.set("directed", reader.is_directed());
+            g_report.set("weighted", reader.is_weighted());
+            g_report.set("wall_time", timer.microseconds() / 1000000.0);
+            g_report.set("cpu_time", get_cpu_time());
+            g_report.set("peak_rss", get_peak_rss());
+            g_report.save(g_path_report);
+        }
+        if(!g_path_trace.empty()){
+            g_tracer.save(g_path_trace);
+        }
     } catch (common::Error& e){
         cerr << e << endl;
         cerr << "Type `" << argv[0] << " --help' to check how to run the program\n";
@@ -72,87 +120,102 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    cout << "\nDone. Whole completion time: " << timer << "\n";
+    cout << "\nDone. Whole completion time: " << timer << ", peak memory: " << to_string_bytes(get_peak_rss()) << "\n";
 
     return 0;
 }
 
-static pair<uint64_t, vector<WeightedEdge>> parse_input(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms){
-    unordered_map<uint64_t, uint64_t> vertices;
-    vertices.reserve( stoull(reader.get_property("meta.vertices")));
-    using P = decltype(vertices)::value_type;
-    uint64_t next_vertex_id = 0;
-
-    Timer timer; timer.start();
-    if(g_sorted_order_vertices){ // respect the same sorted order of the vertices appearing in the input graph
-        LOG("Reading the input vertices ...");
-
-        uint64_t vertex_id = 0;
-        while(reader.read_vertex(vertex_id)){
-            vertices[vertex_id] = next_vertex_id++;
-        }
-
-        LOG("Input vertices parsed in " << timer);
-        assert(vertices.size() == stoull(reader.get_property("meta.vertices")) && "Cardinality mismatch");
+// select the instance of the pipeline for the properties of the graph
+template<typename E>
+static void run(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms){
+    if(reader.is_directed()){
+        run<E, true>(reader, algorithms);
+    } else {
+        run<E, false>(reader, algorithms);
     }
+}
 
-    LOG("Reading the input edges ...");
-    timer.start();
-
-    pair<uint64_t, vector<WeightedEdge>> result;
-    result.second.reserve(stoull(reader.get_property("meta.edges")));
-    WeightedEdge edge;
-    while(reader.read_edge(edge.m_source, edge.m_destination, edge.m_weight)){
-
-        auto v1 = vertices.insert(P{edge.m_source, next_vertex_id});
-        if(v1.second){ next_vertex_id++; } // new vertex
-        edge.m_source = v1.first->second;
-
-        auto v2 = vertices.insert(P{edge.m_destination, next_vertex_id});
-        if(v2.second){ next_vertex_id++; } // new vertex
-        edge.m_destination = v2.first->second;
+template<typename E, bool is_directed>
+static void run(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms){
+    // do not parse or generate the weights when they are not going to be stored
+    reader.set_projection(has_weight<E> ? GraphalyticsReader::ALL : GraphalyticsReader::SOURCE | GraphalyticsReader::DESTINATION);
 
-        assert(edge.m_source != edge.m_destination && "Edge with the same source & destination is not allowed");
-        if(!reader.is_directed() && edge.m_source > edge.m_destination) std::swap(edge.m_source, edge.m_destination); // src < dst
+    // remove the suffix ".properties" from the end of the file name
+    smatch matches;
+    regex_match(g_path_output, matches, regex{"^(.+?)(\\.properties)?$"});
+    string prefix = matches[1];
 
-        result.second.push_back(edge);
+    // the property file of the first format is <prefix>.properties, the others <prefix>-<format>.properties
+    vector<string> paths_properties;
+    for(uint64_t i = 0; i < g_output_formats.size(); i++){
+        paths_properties.push_back(prefix + (i == 0 ? "" : "-" + to_string(g_output_formats[i])) + ".properties");
     }
 
-    result.first = next_vertex_id; // number of vertices created
-
-    // Source for the BFS algorithm
-    if(algorithms.bfs.m_enabled){
-        assert(vertices.count(algorithms.bfs.m_source_vertex) > 0 && "The vertex does not exist");
-        algorithms.bfs.m_source_vertex = vertices[ algorithms.bfs.m_source_vertex ];
+    uint64_t num_vertices = 0;
+    uint64_t num_edges = 0;
+    // the max errors of the weights, the two maxima may come from different edges hence they are not summed
+    double rounding_error = 0; // between the parsed weights and those stored in memory
+    double encoding_error = 0; // between the weights stored in memory and those encoded in the output
+    if(g_sequential && (g_low_memory || g_memory_policy.is_enabled())){ // the edge array is a mapping, grown by remapping its pages
+        run_sequential<E, is_directed, MappedVector<E>>(reader, algorithms, prefix, paths_properties, num_vertices, num_edges, rounding_error, encoding_error);
+    } else if(g_sequential){
+        run_sequential<E, is_directed, vector<E>>(reader, algorithms, prefix, paths_properties, num_vertices, num_edges, rounding_error, encoding_error);
+    } else { // overlap the I/O with the computation
+        OverlappedPipeline<E, is_directed> pipeline;
+        auto input = pipeline.parse(reader, algorithms, g_sorted_order_vertices);
+        num_vertices = input.m_num_vertices;
+        num_edges = pipeline.num_edges();
+        if(has_weight<E>){ validate_weight_range(g_weight_type, input.m_min_weight, input.m_max_weight); } // before creating any file
+
+        // the formats are written concurrently, each with its own encoder
+        vector<WeightEncoder> encoders;
+        for(uint64_t i = 0; i < g_output_formats.size(); i++){ encoders.emplace_back(g_weight_type, input.m_max_weight); }
+        pipeline.save(input.m_num_vertices, g_output_formats, prefix, encoders);
+        for(uint64_t i = 0; i < g_output_formats.size(); i++){ // last, only once the graph has been stored
+            save_properties(reader, algorithms, encoders[i], g_output_formats[i], prefix, paths_properties[i]);
+        }
+        rounding_error = input.m_rounding_error;
+        encoding_error = encoders[0].max_error(); // the same weights are encoded in each format
     }
 
-    // Source for the SSSP algorithm
-    if(algorithms.sssp.m_enabled){
-        assert(vertices.count(algorithms.sssp.m_source_vertex) > 0 && "The vertex does not exist");
-        algorithms.sssp.m_source_vertex = vertices [ algorithms.sssp.m_source_vertex ];
+    g_report.set("vertices", num_vertices);
+    g_report.set("edges", num_edges);
+    if(has_weight<E> && g_weight_type != WeightType::FLOAT64){
+        if(is_same_v<E, CompactWeightedEdge>){ LOG("Max rounding error of the weights stored in memory: " << rounding_error); }
+        LOG("Max quantization error of the weights encoded in the output (" << g_weight_type << "): " << encoding_error);
     }
-
-    timer.stop();
-    LOG("Input edges parsed in " << timer);
-
-    return result;
 }
 
-static void sort_edges(vector<WeightedEdge>& edges){
-    LOG("Sorting the list of edges ...");
-    Timer timer; timer.start();
-
-    std::sort(edges.data(), edges.data() + edges.size(), [](const WeightedEdge& e1, const WeightedEdge& e2){
-        return (e1.m_source < e2.m_source) || (e1.m_source == e2.m_source && e1.m_destination < e2.m_destination);
-    });
-
-    timer.stop();
-    LOG("Edges sorted in " << timer);
+// parse, sort and store the graph, one stage after the other
+template<typename E, bool is_directed, typename Edges>
+static void run_sequential(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, const string& prefix, const vector<string>& paths_properties, uint64_t& num_vertices, uint64_t& num_edges, double& rounding_error, double& encoding_error){
+    // the dictionary of the vertices is released once parse_input returns, before the edges are sorted
+    InputGraph<E, Edges> input = parse_input<E, is_directed, Edges>(reader, algorithms, g_sorted_order_vertices);
+    if(g_low_memory){
+        malloc_trim(0); // return the nodes of the dictionary to the OS, rather than keeping them in the free lists
+        LOG("Peak memory after parsing: " << to_string_bytes(get_peak_rss()));
+    }
+    sort_edges(input); // in place
+    num_vertices = input.m_num_vertices;
+    num_edges = input.m_edges.size();
+    if(has_weight<E>){ validate_weight_range(g_weight_type, input.m_min_weight, input.m_max_weight); } // before creating any file
+
+    // the fixed point representations are scaled on the greatest weight in the graph
+    WeightEncoder encoder { g_weight_type, input.m_max_weight };
+
+    // store the new graph, in each format
+    for(uint64_t i = 0; i < g_output_formats.size(); i++){
+        save_graph(g_output_formats[i], input.m_edges, input.m_num_vertices, prefix, encoder);
+        save_properties(reader, algorithms, encoder, g_output_formats[i], prefix, paths_properties[i]); // last, only once the graph has been stored
+    }
+    rounding_error = input.m_rounding_error;
+    encoding_error = encoder.max_error();
 }
 
-static void save_properties(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, const string& path_prefix){
-    string path_output = path_prefix + ".properties";
+static void save_properties(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, const WeightEncoder& encoder, OutputFormat format, const string& path_prefix, const string& path_properties){
+    const string& path_output = path_properties;
     LOG("Saving the property file " << path_output << " ...");
+    ReportStage stage { "save-properties" };
     Timer timer; timer.start();
 
     fstream out {path_output , ios::out };
@@ -160,11 +223,15 @@ static void save_properties(GraphalyticsReader& reader, GraphalyticsAlgorithms&
     out << "# Created by vtxremap, on " << get_current_datetime() << "\n\n";
 
 //    string basedir = common::filesystem::directory(path_prefix);
-    string basename = common::filesystem::filename(path_prefix);
+    string basename = common::filesystem::filename(path_output.substr(0, path_output.size() - string(".properties").size())); // name of the graph
 
     out << "# Filenames of graph on local filesystem\n";
-    out << "graph." << basename << ".vertex-file = " << basename << (g_compress_output ? ".vz" : ".v") << "\n";
-    out << "graph." << basename << ".edge-file = " << basename << (g_compress_output ? ".ez" : ".e") << "\n\n";
+    if(format == OutputFormat::CSR){
+        out << "graph." << basename << ".csr-file = " << common::filesystem::filename(path_edge_file(format, path_prefix)) << "\n\n";
+    } else {
+        out << "graph." << basename << ".vertex-file = " << common::filesystem::filename(path_vertex_file(format, path_prefix)) << "\n";
+        out << "graph." << basename << ".edge-file = " << common::filesystem::filename(path_edge_file(format, path_prefix)) << "\n\n";
+    }
 
     out << "# Graph metadata for reporting purposes\n";
     out << "graph." << basename << ".meta.vertices = " << reader.get_property("meta.vertices") << "\n";
@@ -174,13 +241,18 @@ static void save_properties(GraphalyticsReader& reader, GraphalyticsAlgorithms&
     out << "graph." << basename << ".meta.input-graph = " << common::filesystem::filename(g_path_input) << "\n\n";
 
     out << "# Properties describing the graph format\n";
-    if(g_compress_output){ out << "graph." << basename << ".compression = zlib\n"; }
+    if(format == OutputFormat::ZLIB){ out << "graph." << basename << ".compression = zlib\n"; }
+    if(format == OutputFormat::CSR){ out << "graph." << basename << ".format = csr\n"; }
     out << "graph." << basename << ".directed = " << (reader.is_directed() ? "true" : "false") << "\n\n";
 
     if(reader.is_weighted()){
         out << "# Description of graph properties\n";
         out << "graph." << basename << ".edge-properties.names = weight\n";
-        out << "graph." << basename << ".edge-properties.types = real\n\n";
+        out << "graph." << basename << ".edge-properties.types = " << encoder.type() << "\n";
+        if(encoder.type() == WeightType::FIXED16 || encoder.type() == WeightType::FIXED24){
+            out << "graph." << basename << ".edge-properties.scale = " << setprecision(17) << encoder.scale() << setprecision(6) << "\n";
+        }
+        out << "\n";
     }
 
     out << "# List of supported algorithms on the graph\n";
@@ -223,154 +295,40 @@ static void save_properties(GraphalyticsReader& reader, GraphalyticsAlgorithms&
     out.close();
 
     timer.stop();
+    stage->m_bytes_written = file_size(path_output);
+    stage.close();
     LOG("Property file saved in " << timer);
 }
 
-static void save_vertices(uint64_t num_vertices, const string& path_output){
-    LOG("Saving the vertex file " << path_output << " ...");
-    Timer timer; timer.start();
-
-    fstream out { path_output , ios::out | ios::binary };
-    if(!out.good()) ERROR("Cannot create the file " << path_output);
-
-    if(g_compress_output){ // compressed output
-        constexpr uint64_t buffer_sz = (1 << 20); // * sizeof(uint64_t)
-        unique_ptr<uint64_t[]> ptr_input_buffer { new uint64_t[buffer_sz] };
-        uint64_t* input_buffer = ptr_input_buffer.get();
-        unique_ptr<uint64_t[]> ptr_output_buffer { new uint64_t[buffer_sz] };
-        unsigned char* output_buffer = reinterpret_cast<unsigned char*>(ptr_output_buffer.get());
-        uint64_t next_vertex_id = 0;
-
-        z_stream stream; int rc (0);
-        stream.zalloc = Z_NULL;
-        stream.zfree = Z_NULL;
-        stream.opaque = Z_NULL;
-        stream.avail_in = 0;
-        stream.avail_out = 0;
-        rc = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
-        if(rc != Z_OK) ERROR("Cannot initialise the zlib stream");
-
-        do {
-            // input, the data that has to be compressed
-            if(stream.avail_in == 0){
-                uint64_t chunk_sz = min(num_vertices - next_vertex_id, buffer_sz);
-                for(uint64_t i = 0; i < chunk_sz; i++){
-                    input_buffer[i] = next_vertex_id +i;
-                }
-                next_vertex_id += chunk_sz;
-
-                stream.next_in = reinterpret_cast<decltype(stream.next_in)>(input_buffer);
-                stream.avail_in = chunk_sz * sizeof(uint64_t);
-            }
-
-            // output, the data compressed by zlib
-            stream.avail_out = buffer_sz * sizeof(uint64_t);
-            stream.next_out = output_buffer;
-
-            // invoke zlib
-            rc = deflate(&stream, (next_vertex_id >= num_vertices) ? Z_FINISH : Z_NO_FLUSH);
-            if(rc != Z_OK && rc != Z_STREAM_END) ERROR("Compression error");
-
-            // flush to disk
-            uint64_t bytes_compressed = buffer_sz * sizeof(uint64_t) - stream.avail_out;
-            out.write((char*) output_buffer, bytes_compressed);
-        } while(stream.avail_in > 0 || next_vertex_id < num_vertices);
-
-        rc = deflateEnd(&stream);
-        if(rc != Z_OK) ERROR("Cannot close the zlib stream");
-
-    } else { // plain output
-        for(uint64_t i = 0; i < num_vertices; i++){
-            out << i << "\n";
-        }
-    }
-
-    out.close();
-    timer.stop();
-    LOG("Vertex file saved in " << timer);
-}
-
-static void save_edges(vector<WeightedEdge>& edges, const string& path_output, bool is_weighted){
-    LOG("Saving the edge file " << path_output << " ...");
-    Timer timer; timer.start();
-
-    fstream out { path_output, ios::out | ios::binary };
-    if(!out.good()) ERROR("Cannot create the file " << path_output);
-
-    if(g_compress_output){ // compressed output
-        constexpr uint64_t buffer_sz (1 << 20); // * sizeof(uint64_t)
-        unique_ptr<uint64_t[]> ptr_input_buffer { new uint64_t[buffer_sz * 3 /* src + dst + weight */ ] };
-        uint64_t* input_buffer = ptr_input_buffer.get();
-        unique_ptr<uint64_t[]> ptr_output_buffer { new uint64_t[buffer_sz] };
-        unsigned char* output_buffer = reinterpret_cast<unsigned char*>(ptr_output_buffer.get());
-        uint64_t next_edge_id = 0;
-
-        z_stream stream; int rc (0);
-        stream.zalloc = Z_NULL;
-        stream.zfree = Z_NULL;
-        stream.opaque = Z_NULL;
-        stream.avail_in = 0;
-        stream.avail_out = 0;
-        rc = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
-        if(rc != Z_OK) ERROR("Cannot initialise the zlib stream");
-
-        do {
-            // input, the data that has to be compressed
-            if(stream.avail_in == 0){
-                uint64_t chunk_sz = min(edges.size() - next_edge_id, buffer_sz);
-                uint64_t increment = is_weighted ? 3 : 2;
-                for(uint64_t i = 0, j = 0; i < chunk_sz; i++, j += increment){
-                    auto e = edges[next_edge_id +i];
-                    input_buffer[j] = e.source();
-                    input_buffer[j +1] = e.destination();
-                    if(is_weighted){ reinterpret_cast<double*>(input_buffer)[j +2] = e.m_weight; }
-                }
-                next_edge_id += chunk_sz;
-
-                stream.next_in = reinterpret_cast<decltype(stream.next_in)>(input_buffer);
-                stream.avail_in = chunk_sz * sizeof(uint64_t) * increment;
-            }
-
-            // output, the data compressed by zlib
-            stream.avail_out = buffer_sz * sizeof(uint64_t);
-            stream.next_out = output_buffer;
-
-            // invoke zlib
-            rc = deflate(&stream, (next_edge_id >= edges.size()) ? Z_FINISH : Z_NO_FLUSH);
-            if(rc != Z_OK && rc != Z_STREAM_END) ERROR("Compression error");
-
-            // flush to disk
-            uint64_t bytes_compressed = buffer_sz * sizeof(uint64_t) - stream.avail_out;
-            out.write((char*) output_buffer, bytes_compressed);
-        } while(stream.avail_in > 0 || next_edge_id < edges.size());
-
-        rc = deflateEnd(&stream);
-        if(rc != Z_OK) ERROR("Cannot close the zlib stream");
-
-    } else { // plain output
-        for(uint64_t i = 0, sz = edges.size(); i < sz; i++){
-            out << edges[i].source() << " " << edges[i].destination();
-            if(is_weighted){
-                out << " " << edges[i].weight();
-            }
-            out << "\n";
-        }
-    }
-
-    out.close();
-    timer.stop();
-    LOG("Edge file saved in " << timer);
-}
-
 static void parse_command_line_arguments(int argc, char* argv[]){
     using namespace cxxopts;
 
     Options options(argv[0], "Graphalytics vertex remapper (vtxremap): remap the vertices ID of the input graph into the dense domain [0, num_vertices)");
-    options.custom_help(" [options] <input> <output>");
+    options.custom_help(" [options] <input> <output>\n  " + string(argv[0]) + " --batch [options] <input directory> <output directory>");
     options.add_options()
-            ("c, compress", "Compress the output vertices and edges with zlib")
+            ("b, batch", "Convert all graphs in the input directory, storing each graph <name> as <name>-dense.properties in the output directory. "
+                    "Without --format, the graphs are compressed with zlib")
+            ("c, compress", "Compress the output vertices and edges with zlib, same as --format zlib")
+            ("cache", "Store the parsed edges in a binary snapshot next to the input edge file, and load it in the next runs rather than parsing the text")
+            ("direct-io", "Write the output files with O_DIRECT, bypassing the page cache")
+            ("f, format", "The formats of the output graph, as a comma separated list of plain, zlib and csr, all written from the same sorted edges. "
+                    "The property file of the first format is <output>.properties, the others <output>-<format>.properties", value<string>())
             ("h, help", "Show this help menu")
+            ("huge-pages", "Back the edge array and the vertex dictionary with transparent huge pages, to reduce the TLB misses")
+            ("io-depth", "Max number of writes in flight for each output file", value<uint64_t>()->default_value(to_string(g_output_options.m_queue_depth)))
+            ("io-engine", "How to write the output files: auto, uring (io_uring) or thread (pwrite in a background thread)", value<string>()->default_value("auto"))
+            ("j, jobs", "Batch mode, max number of graphs converted concurrently", value<uint64_t>()->default_value(to_string(num_available_cores())))
+            ("low-memory", "Minimise the peak memory: execute the stages one after the other, grow the edge array without copying it and release the dictionary before sorting")
+            ("memory-budget", "Batch mode, max memory of the graphs converted concurrently, in MB. Default: 80% of the physical memory", value<uint64_t>())
+            ("numa-interleave", "Interleave the pages of the edge array and the vertex dictionary among all NUMA nodes")
+            ("p, perf", "Sample the hardware performance counters (cycles, instructions, cache & TLB misses) for each stage")
+            ("r, report", "Save the statistics of each stage in the given file, in JSON", value<string>())
+            ("sequential", "Execute the stages one after the other, without overlapping the I/O with the computation")
+            ("sort-threads", "Number of threads sorting the edges", value<uint64_t>()->default_value(to_string(num_available_cores())))
             ("s, stable", "Respect the sorted order of the vertices in the mapping")
+            ("t, trace", "Record the timeline of the threads in the given file, in the Chrome trace format (JSON)", value<string>())
+            ("w, weights", "The representation of the weights: double, float, fixed16 or fixed24. The fixed point representations are scaled on "
+                    "the greatest weight of the graph and only accept the weights in [0, max weight], the conversion fails on negative weights", value<string>()->default_value("double"))
             ;
 
     auto parsed_args = options.parse(argc, argv);
@@ -383,20 +341,108 @@ static void parse_command_line_arguments(int argc, char* argv[]){
     if( argc != 3 ) {
         INVALID_ARGUMENT("Invalid number of arguments: " << argc << ". Expected format: " << argv[0] << " [options] <input> <output>");
     }
+
+    // the output formats
+    if(parsed_args.count("format") > 0){
+        stringstream ss { parsed_args["format"].as<string>() };
+        string name;
+        while(getline(ss, name, ',')){
+            OutputFormat format = output_format_from_string(name);
+            if(find(begin(g_output_formats), end(g_output_formats), format) != end(g_output_formats)){ INVALID_ARGUMENT("The format " << format << " is repeated"); }
+            g_output_formats.push_back(format);
+        }
+    }
+    if(parsed_args.count("compress") > 0 && find(begin(g_output_formats), end(g_output_formats), OutputFormat::ZLIB) == end(g_output_formats)){
+        g_output_formats.push_back(OutputFormat::ZLIB);
+    }
+    g_batch = parsed_args.count("batch") > 0;
+    if(g_output_formats.empty()){ // plain by default, zlib in batch mode as the former scripts/transform_batch.pl
+        g_output_formats.push_back(g_batch ? OutputFormat::ZLIB : OutputFormat::PLAIN);
+    }
+
+    if(g_batch){
+        if(parsed_args.count("report") || parsed_args.count("trace") || parsed_args.count("perf")){
+            INVALID_ARGUMENT("The options --report, --trace and --perf are not supported in batch mode");
+        }
+        BatchSettings& settings = g_batch_settings;
+        settings.m_input_directory = argv[1];
+        settings.m_output_directory = argv[2];
+        settings.m_num_jobs = parsed_args["jobs"].as<uint64_t>();
+        if(settings.m_num_jobs == 0){ INVALID_ARGUMENT("The option --jobs must be greater than zero"); }
+        settings.m_memory_budget = parsed_args.count("memory-budget") ? parsed_args["memory-budget"].as<uint64_t>() * (1ull << 20) : default_memory_budget();
+        settings.m_weight_type = weight_type_from_string( parsed_args["weights"].as<string>() );
+
+        // the options forwarded to each conversion
+        vector<string>& args = settings.m_arguments;
+        args.push_back("--format=" + get_output_formats());
+        if(parsed_args.count("stable")){ args.push_back("--stable"); }
+        if(parsed_args.count("cache")){ args.push_back("--cache"); }
+        if(parsed_args.count("low-memory")){ args.push_back("--low-memory"); }
+        if(parsed_args.count("huge-pages")){ args.push_back("--huge-pages"); }
+        if(parsed_args.count("numa-interleave")){ args.push_back("--numa-interleave"); }
+        // the pool already keeps the cores busy, do not oversubscribe them with the threads of each conversion
+        if(parsed_args.count("sequential") || settings.m_num_jobs > 1){ args.push_back("--sequential"); }
+        args.push_back("--sort-threads=" + to_string(settings.m_num_jobs > 1 ? 1 : parsed_args["sort-threads"].as<uint64_t>()));
+        if(parsed_args.count("direct-io")){ args.push_back("--direct-io"); }
+        args.push_back("--weights=" + parsed_args["weights"].as<string>());
+        args.push_back("--io-engine=" + parsed_args["io-engine"].as<string>());
+        args.push_back("--io-depth=" + to_string(parsed_args["io-depth"].as<uint64_t>()));
+
+        cout << "Input directory: " << settings.m_input_directory << "\n";
+        cout << "Output directory: " << settings.m_output_directory << "\n";
+        cout << "Max concurrent conversions: " << settings.m_num_jobs << "\n";
+        cout << "Memory budget: " << settings.m_memory_budget / (1ull << 20) << " MB\n";
+        cout << "Options of each conversion:"; for(auto& arg : args){ cout << " " << arg; }
+        cout << "\n" << endl;
+        return;
+    }
+
     if(!common::filesystem::file_exists(argv[1])){
         INVALID_ARGUMENT("The given input graph does not exist: `" << argv[1] << "'");
     }
 
     g_path_input = argv[1];
     g_path_output = argv[2];
-    g_compress_output = parsed_args.count("compress");
     g_sorted_order_vertices = parsed_args.count("stable");
+    g_parse_cache = parsed_args.count("cache") > 0;
+    g_low_memory = parsed_args.count("low-memory") > 0;
+    g_memory_policy.m_huge_pages = parsed_args.count("huge-pages") > 0;
+    g_memory_policy.m_interleave = parsed_args.count("numa-interleave") > 0;
+    // nothing to overlap with a single core, while the overlapped pipeline holds the sorted runs and their merge at the same time
+    g_sequential = parsed_args.count("sequential") || num_available_cores() == 1 || g_low_memory;
+    g_weight_type = weight_type_from_string( parsed_args["weights"].as<string>() );
+    g_num_sort_threads = parsed_args["sort-threads"].as<uint64_t>();
+    if(g_num_sort_threads == 0){ INVALID_ARGUMENT("The option --sort-threads must be greater than zero"); }
+    g_output_options.m_engine = output_engine_from_string( parsed_args["io-engine"].as<string>() );
+    g_output_options.m_queue_depth = parsed_args["io-depth"].as<uint64_t>();
+    if(g_output_options.m_queue_depth == 0){ INVALID_ARGUMENT("The option --io-depth must be greater than zero"); }
+    g_output_options.m_direct_io = parsed_args.count("direct-io") > 0;
+    if(parsed_args.count("perf") > 0){
+        g_perf.enable();
+        g_perf.set_thread_name("main");
+    }
+    if(parsed_args.count("report") > 0){ g_path_report = parsed_args["report"].as<string>(); }
+    if(parsed_args.count("trace") > 0){
+        g_path_trace = parsed_args["trace"].as<string>();
+        g_tracer.enable();
+        g_tracer.set_thread_name("main");
+    }
 
     cout << "Path input graph: " << g_path_input << "\n";
     cout << "Path output log: " << g_path_output << "\n";
-    cout << "Compress the output with zlib: " << boolalpha << g_compress_output << "\n";
+    cout << "Output formats: " << get_output_formats() << "\n";
     cout << "Respect the sorted order: " << boolalpha << g_sorted_order_vertices << "\n";
+    cout << "Cache the parsed input: " << boolalpha << g_parse_cache << "\n";
+    cout << "Overlap the stages: " << boolalpha << !g_sequential << "\n";
+    cout << "Low memory mode: " << boolalpha << g_low_memory << "\n";
+    cout << "Sort threads: " << g_num_sort_threads << "\n";
+    cout << "Huge pages: " << boolalpha << g_memory_policy.m_huge_pages << ", NUMA interleaving: " << boolalpha << g_memory_policy.m_interleave << " (nodes: " << num_numa_nodes() << ")\n";
+    cout << "Representation of the weights: " << g_weight_type << "\n";
+    cout << "Output engine: " << parsed_args["io-engine"].as<string>() << ", depth: " << g_output_options.m_queue_depth << ", direct I/O: " << boolalpha << g_output_options.m_direct_io << "\n";
+    if(!g_path_report.empty()){ cout << "Path to the report: " << g_path_report << "\n"; }
+    if(!g_path_trace.empty()){ cout << "Path to the trace: " << g_path_trace << "\n"; }
     cout << endl;
+    check_memory_policy();
 }
 
 static string get_current_datetime(){
@@ -408,3 +454,10 @@ static string get_current_datetime(){
     if(rc == 0) ERROR("strftime");
     return string(buffer);
 }
+
+// the output formats as a comma separated list, e.g. plain,zlib
+static string get_output_formats(){
+    string result;
+    for(auto format : g_output_formats){ result += (result.empty() ? "" : ",") + to_string(format); }
+    return result;
+}
@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+#include "memory_policy.hpp"
+
+/**
+ * A growable array of trivially copyable elements, backed by an anonymous memory mapping rather than the heap. When the
+ * capacity is exhausted, the mapping is extended with mremap, which moves the page table entries instead of copying
+ * the elements: unlike a std::vector, the old and the new array never coexist in memory. The pages are only backed by
+ * physical memory once they are written, hence reserving an overestimate of the final size is cheap. The mapping is
+ * subject to the global memory policy, e.g. huge pages.
+ */
+template<typename T>
+class MappedVector {
+    static_assert(std::is_trivially_copyable_v<T>, "The elements are moved by remapping their pages");
+
+    T* m_data = nullptr; // the start of the mapping
+    uint64_t m_size = 0; // number of elements stored
+    uint64_t m_capacity = 0; // number of elements that fit in the mapping
+
+    // the size of the mapping for the given capacity, rounded up to a multiple of the page size
+    static uint64_t mapping_size(uint64_t capacity){
+        static const uint64_t page_sz = sysconf(_SC_PAGESIZE);
+        return (capacity * sizeof(T) + page_sz -1) / page_sz * page_sz;
+    }
+
+    // resize the mapping to hold at least `capacity' elements
+    void remap(uint64_t capacity){
+        const uint64_t new_size = mapping_size(capacity);
+        void* ptr = nullptr;
+        if(m_data == nullptr){
+            ptr = map_memory(new_size);
+        } else {
+            ptr = mremap(m_data, mapping_size(m_capacity), new_size, MREMAP_MAYMOVE);
+            if(ptr == MAP_FAILED) throw std::bad_alloc();
+            apply_memory_policy(ptr, new_size); // the pages being added
+        }
+        m_data = reinterpret_cast<T*>(ptr);
+        m_capacity = new_size / sizeof(T);
+    }
+
+    // unmap the array
+    void release() noexcept {
+        if(m_data != nullptr){ unmap_memory(m_data, mapping_size(m_capacity)); }
+        m_data = nullptr;
+        m_size = m_capacity = 0;
+    }
+
+public:
+    using value_type = T;
+
+    MappedVector() = default;
+    MappedVector(const MappedVector&) = delete;
+    MappedVector& operator=(const MappedVector&) = delete;
+    MappedVector(MappedVector&& other) noexcept :
+        m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)), m_capacity(std::exchange(other.m_capacity, 0)) { }
+    MappedVector& operator=(MappedVector&& other) noexcept {
+        if(this != &other){
+            release();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_capacity = std::exchange(other.m_capacity, 0);
+        }
+        return *this;
+    }
+    ~MappedVector(){ release(); }
+
+    // ensure the array can hold at least `capacity' elements without being remapped
+    void reserve(uint64_t capacity){ if(capacity > m_capacity) remap(capacity); }
+
+    // append an element at the end of the array, growing the mapping by 50% when it is full
+    void push_back(const T& value){
+        if(m_size == m_capacity) remap(m_capacity + std::max<uint64_t>(m_capacity / 2, 1));
+        m_data[m_size++] = value;
+    }
+
+    // remove all elements and return the memory to the OS
+    void clear() noexcept { release(); }
+
+    T* data() noexcept { return m_data; }
+    const T* data() const noexcept { return m_data; }
+    uint64_t size() const noexcept { return m_size; }
+    uint64_t capacity() const noexcept { return m_capacity; }
+    bool empty() const noexcept { return m_size == 0; }
+    T& operator[](uint64_t i) noexcept { assert(i < m_size); return m_data[i]; }
+    const T& operator[](uint64_t i) const noexcept { assert(i < m_size); return m_data[i]; }
+    T* begin() noexcept { return m_data; }
+    T* end() noexcept { return m_data + m_size; }
+    const T* begin() const noexcept { return m_data; }
+    const T* end() const noexcept { return m_data + m_size; }
+};
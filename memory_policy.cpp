@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memory_policy.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "lib/common/error.hpp"
+
+using namespace std;
+
+MemoryPolicy g_memory_policy;
+
+// the constant MPOL_INTERLEAVE of <numaif.h>, the system call is invoked directly rather than linking libnuma
+constexpr int g_mpol_interleave = 3;
+
+// the bit mask of the NUMA nodes with memory, as expected by mbind
+static vector<unsigned long> numa_node_mask(){
+    vector<unsigned long> mask;
+    fstream in { "/sys/devices/system/node/has_memory", ios::in }; // e.g. 0-1 or 0,2-3
+    string ranges;
+    if(!in.good() || !getline(in, ranges)) return mask;
+
+    stringstream ss { ranges };
+    string range;
+    constexpr uint64_t bits = 8 * sizeof(unsigned long);
+    while(getline(ss, range, ',')){
+        auto dash = range.find('-');
+        uint64_t first = stoull(range.substr(0, dash));
+        uint64_t last = (dash == string::npos) ? first : stoull(range.substr(dash +1));
+        for(uint64_t node = first; node <= last; node++){
+            if(mask.size() <= node / bits) mask.resize(node / bits +1);
+            mask[node / bits] |= 1ul << (node % bits);
+        }
+    }
+    return mask;
+}
+
+uint64_t num_numa_nodes(){
+    uint64_t result = 0;
+    for(unsigned long word : numa_node_mask()){ result += __builtin_popcountl(word); }
+    return max<uint64_t>(result, 1);
+}
+
+void check_memory_policy(){
+    if(g_memory_policy.m_huge_pages){
+        fstream in { "/sys/kernel/mm/transparent_hugepage/enabled", ios::in }; // e.g. always [madvise] never
+        string mode;
+        if(!in.good() || !getline(in, mode)){
+            cout << "[MemoryPolicy] Warning, the kernel does not support transparent huge pages, the option --huge-pages has no effect" << endl;
+        } else if(mode.find("[never]") != string::npos){
+            cout << "[MemoryPolicy] Warning, transparent huge pages are disabled in /sys/kernel/mm/transparent_hugepage/enabled, the option --huge-pages has no effect" << endl;
+        }
+    }
+
+    if(g_memory_policy.m_interleave){
+        vector<unsigned long> mask = numa_node_mask();
+        if(mask.empty()){
+            cout << "[MemoryPolicy] Warning, cannot retrieve the NUMA nodes of the machine, the option --numa-interleave has no effect" << endl;
+        } else if(num_numa_nodes() == 1){
+            cout << "[MemoryPolicy] Warning, the machine has a single NUMA node, the option --numa-interleave has no effect" << endl;
+        }
+    }
+}
+
+void apply_memory_policy(void* addr, uint64_t size){
+    if(g_memory_policy.m_huge_pages){
+        if(madvise(addr, size, MADV_HUGEPAGE) != 0){ // e.g. the kernel has been built without transparent huge pages
+            int error = errno;
+            static once_flag warning;
+            call_once(warning, [&](){ cout << "[MemoryPolicy] Warning, transparent huge pages are not available: " << strerror(error) << ", using the default pages" << endl; });
+        }
+    }
+
+    if(g_memory_policy.m_interleave){
+        static const vector<unsigned long> mask = numa_node_mask();
+        if(mask.empty()) return;
+        long rc = syscall(SYS_mbind, addr, size, g_mpol_interleave, mask.data(), mask.size() * 8 * sizeof(unsigned long) +1, 0);
+        if(rc != 0){ // e.g. a kernel without NUMA support
+            int error = errno;
+            static once_flag warning;
+            call_once(warning, [&](){ cout << "[MemoryPolicy] Warning, cannot interleave the memory among the NUMA nodes: " << strerror(error) << endl; });
+        }
+    }
+}
+
+void* map_memory(uint64_t size){
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(ptr == MAP_FAILED) throw bad_alloc();
+    apply_memory_policy(ptr, size);
+    return ptr;
+}
+
+void unmap_memory(void* addr, uint64_t size) noexcept {
+    munmap(addr, size);
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  MemoryArena                                                              *
+ *                                                                           *
+ *****************************************************************************/
+
+// the size of a standalone mapping, rounded up to a multiple of the page size
+static uint64_t mapping_size(uint64_t size){
+    static const uint64_t page_sz = sysconf(_SC_PAGESIZE);
+    return (size + page_sz -1) / page_sz * page_sz;
+}
+
+MemoryArena::~MemoryArena(){
+    for(char* chunk : m_chunks){ unmap_memory(chunk, s_chunk_size); }
+}
+
+void* MemoryArena::allocate(uint64_t size, uint64_t alignment){
+    if(size > s_chunk_size / 4){ // large block, on its own
+        return map_memory(mapping_size(size));
+    }
+
+    uint64_t padding = (alignment - reinterpret_cast<uintptr_t>(m_next) % alignment) % alignment;
+    if(m_next == nullptr || m_next + padding + size > m_end){ // start a new chunk
+        m_chunks.push_back(static_cast<char*>(map_memory(s_chunk_size)));
+        m_next = m_chunks.back();
+        m_end = m_next + s_chunk_size;
+        padding = 0; // the chunks are aligned to a page
+    }
+
+    void* result = m_next + padding;
+    m_next += padding + size;
+    return result;
+}
+
+void MemoryArena::deallocate(void* ptr, uint64_t size) noexcept {
+    if(size > s_chunk_size / 4){
+        unmap_memory(ptr, mapping_size(size));
+    } // else, the block is released together with its chunk
+}
@@ -0,0 +1,133 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Placement of the large arrays of the program, the edge array and the vertex dictionary, in memory
+ */
+struct MemoryPolicy {
+    bool m_huge_pages = false; // whether to back the arrays with transparent huge pages (2 MB), with madvise
+    bool m_interleave = false; // whether to interleave the pages of the arrays among all NUMA nodes
+
+    // whether any setting differs from the default placement of the OS
+    bool is_enabled() const { return m_huge_pages || m_interleave; }
+};
+
+/**
+ * The placement of the arrays for the whole program
+ */
+extern MemoryPolicy g_memory_policy;
+
+/**
+ * Number of NUMA nodes with memory in the machine
+ */
+uint64_t num_numa_nodes();
+
+/**
+ * Warn, on the standard error, about the settings of the global memory policy that have no effect on this machine,
+ * e.g. transparent huge pages disabled by the kernel or a single NUMA node
+ */
+void check_memory_policy();
+
+/**
+ * Apply the global memory policy to the pages in [addr, addr + size), before they are first touched. The address must
+ * be aligned to a page. The settings not supported by the kernel are ignored, with a warning.
+ */
+void apply_memory_policy(void* addr, uint64_t size);
+
+/**
+ * Create an anonymous mapping of `size' bytes, subject to the global memory policy. Throw std::bad_alloc on failure.
+ */
+void* map_memory(uint64_t size);
+
+/**
+ * Release a mapping created by map_memory
+ */
+void unmap_memory(void* addr, uint64_t size) noexcept;
+
+/**
+ * A bump allocator over large mappings, for the many small allocations of a node based container, e.g. the nodes of
+ * an std::unordered_map. Huge pages cannot back the heap of malloc, but they can back the chunks of the arena. The
+ * blocks are never released individually, only when the arena is destroyed. Allocations larger than a quarter of
+ * a chunk, e.g. the buckets of the table, are mapped on their own and released immediately. Not thread safe.
+ */
+class MemoryArena {
+    MemoryArena(const MemoryArena&) = delete;
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    std::vector<char*> m_chunks; // all chunks mapped so far
+    char* m_next = nullptr; // next free byte in the current chunk
+    char* m_end = nullptr; // end of the current chunk
+
+public:
+    static constexpr uint64_t s_chunk_size = (1ull << 25); // 32 MB, a multiple of the size of a huge page
+
+    MemoryArena() = default;
+    ~MemoryArena();
+
+    // allocate a block of the given size and alignment
+    void* allocate(uint64_t size, uint64_t alignment);
+
+    // release a block, only effective for the large blocks
+    void deallocate(void* ptr, uint64_t size) noexcept;
+};
+
+/**
+ * STL allocator serving the memory from a MemoryArena when the global memory policy is enabled, otherwise from the
+ * heap, as std::allocator. The copies and the rebinds of an allocator share the same arena.
+ */
+template<typename T>
+class PolicyAllocator {
+    template<typename U> friend class PolicyAllocator;
+    std::shared_ptr<MemoryArena> m_arena; // null => heap
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    PolicyAllocator() : m_arena( g_memory_policy.is_enabled() ? std::make_shared<MemoryArena>() : nullptr ) { }
+    template<typename U> PolicyAllocator(const PolicyAllocator<U>& other) noexcept : m_arena(other.m_arena) { }
+
+    T* allocate(size_t n){
+        if(m_arena){
+            return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+        } else {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        if(m_arena){
+            m_arena->deallocate(ptr, n * sizeof(T));
+        } else {
+            ::operator delete(ptr);
+        }
+    }
+
+    template<typename U> bool operator==(const PolicyAllocator<U>& other) const noexcept { return m_arena == other.m_arena; }
+    template<typename U> bool operator!=(const PolicyAllocator<U>& other) const noexcept { return m_arena != other.m_arena; }
+};
@@ -0,0 +1,490 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/common/error.hpp"
+#include "lib/common/timer.hpp"
+#include "zlib.h"
+
+#include "async_writer.hpp"
+#include "bounded_queue.hpp"
+#include "csr_writer.hpp"
+#include "memory_policy.hpp"
+#include "perf_counters.hpp"
+#include "pipeline.hpp"
+#include "report.hpp"
+#include "tracer.hpp"
+
+/**
+ * The stages of the conversion executed concurrently, each in its own thread, connected by bounded queues, so that
+ * the I/O of a stage overlaps with the computation of the others:
+ *
+ *   reader -> remapper -> run sorter  ...  merger -> serialiser (zlib, text or csr) -> async writer
+ *                                          vertex writer
+ *
+ * The vertex mapping is built by its own thread, reading the vertex file while the reader parses the edge file; the
+ * remapper retains the batches read meanwhile and remaps them once the mapping is complete. Afterwards, with multiple
+ * sort threads, the remapper still retains the batches in rounds, remapped in parallel as in parse_input. The remapper
+ * cuts the remapped edges into runs, which are sorted, with g_num_sort_threads threads, while the input is still being
+ * read. Once the input has been drained, the sorted runs are merged and streamed to the serialiser, which fills the
+ * buffers of the asynchronous writer of the edge file, while another thread stores the vertex file. With multiple
+ * output formats, the runs are merged once: each chunk of the merged edges is shared by the serialisers of all
+ * formats, and each format has its own serialiser and vertex writer. The output is the same of the sequential
+ * pipeline.
+ */
+template<typename E, bool is_directed>
+class OverlappedPipeline {
+    // A batch of edges read from the input, in a columnar layout
+    using Batch = EdgeBatch<E>;
+
+    // The edges of a run or of a chunk, placed according to g_memory_policy
+    using Edges = std::vector<E, PolicyAllocator<E>>;
+
+    // A chunk of the sorted edges, from the merger to the serialisers of all formats
+    struct Chunk {
+        Edges m_edges;
+        bool m_last = false; // whether this is the last chunk of the edge list
+        std::atomic<uint64_t> m_num_readers = 0; // serialisers that have not consumed the chunk yet
+    };
+
+    // A position in a sorted run, for the merge
+    struct Cursor {
+        const E* m_current;
+        const E* m_end;
+    };
+
+    static constexpr uint64_t s_run_size = (1ull << 22); // number of edges in a run
+    static constexpr uint64_t s_chunk_size = (1ull << 20); // number of edges in a chunk, as in save_edges
+    static constexpr uint64_t s_num_batches = 8; // batches in flight between the reader and the remapper
+    static constexpr uint64_t s_num_chunks = 3; // chunks in flight between the merger and the serialisers
+    static constexpr uint64_t s_num_runs = 4; // unsorted runs in flight between the remapper and the sorter
+
+    std::vector<Edges> m_runs; // the sorted runs, once the input has been parsed
+    std::mutex m_mutex; // protect m_error
+    std::exception_ptr m_error; // the first error raised by a stage
+
+    // Execute the given stage in a new thread. If the stage fails, record the error and cancel the pipeline.
+    template<typename Fn>
+    std::thread spawn(const char* name, Fn fn, std::function<void()> cancel);
+
+    // Rethrow the first error raised by a stage, if any
+    void rethrow_if_error();
+
+    // Merge the sorted runs into chunks, each chunk is handed to all queues in queues_chunks
+    void merge(BoundedQueue<Chunk*>& queue_free, std::vector<std::unique_ptr<BoundedQueue<Chunk*>>>& queues_chunks);
+
+    // A serialiser has consumed the chunk, the last one returns it to queue_free
+    static void release(Chunk* chunk, BoundedQueue<Chunk*>& queue_free);
+
+    // Serialise the chunks, compressed or in text, into the edge file
+    template<bool is_compressed>
+    void serialise(BoundedQueue<Chunk*>& queue_chunks, BoundedQueue<Chunk*>& queue_free, WeightEncoder& encoder, const std::string& path_output);
+
+    // Store the chunks in the compressed sparse row format
+    void serialise_csr(BoundedQueue<Chunk*>& queue_chunks, BoundedQueue<Chunk*>& queue_free, WeightEncoder& encoder, const std::string& path_output, uint64_t num_vertices);
+
+public:
+    /**
+     * Read the input graph, remap its vertices and sort the edges, in runs. The returned graph contains the
+     * properties of the input (number of vertices, max weight, dictionary), but not the edges, retained by the pipeline
+     */
+    InputGraph<E, Edges> parse(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, bool stable_order);
+
+    /**
+     * Total number of edges parsed
+     */
+    uint64_t num_edges() const;
+
+    /**
+     * Store the vertex and the edge files, in each of the given formats. Each format is written by its own threads,
+     * merging the sorted runs independently, with its own encoder for the weights.
+     */
+    void save(uint64_t num_vertices, const std::vector<OutputFormat>& formats, const std::string& path_prefix, std::vector<WeightEncoder>& encoders);
+};
+
+/*****************************************************************************
+ *                                                                           *
+ *  Implementation                                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+template<typename E, bool is_directed>
+template<typename Fn>
+std::thread OverlappedPipeline<E, is_directed>::spawn(const char* name, Fn fn, std::function<void()> cancel){
+    return std::thread([this, name, fn, cancel](){
+        g_tracer.set_thread_name(name);
+        g_perf.set_thread_name(name);
+        try {
+            fn();
+        } catch(...) {
+            { // only retain the first error
+                std::scoped_lock<std::mutex> lock(m_mutex);
+                if(!m_error){ m_error = std::current_exception(); }
+            }
+            cancel();
+        }
+    });
+}
+
+template<typename E, bool is_directed>
+void OverlappedPipeline<E, is_directed>::rethrow_if_error(){
+    std::scoped_lock<std::mutex> lock(m_mutex);
+    if(m_error){ std::rethrow_exception(m_error); }
+}
+
+template<typename E, bool is_directed>
+InputGraph<E, typename OverlappedPipeline<E, is_directed>::Edges> OverlappedPipeline<E, is_directed>::parse(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, bool stable_order){
+    assert(reader.is_directed() == is_directed && "Instance mismatch");
+    InputGraph<E, Edges> result;
+
+    LOG("Reading the input edges ...");
+    common::Timer timer; timer.start();
+
+    // with multiple threads, the remapper retains the batches in rounds, to remap them in parallel
+    const uint64_t num_batches_per_round = g_num_sort_threads > 1 ? 4 * g_num_sort_threads : 1;
+    BoundedQueue<std::unique_ptr<Batch>> queue_free { std::numeric_limits<size_t>::max() }; // empty batches, more are allocated while the mapping is built
+    BoundedQueue<std::unique_ptr<Batch>> queue_batches { s_num_batches }; // reader -> remapper
+    BoundedQueue<std::pair<Edges, EdgeRuns>> queue_runs { s_num_runs }; // remapper -> run sorter
+    for(uint64_t i = 0; i < s_num_batches + num_batches_per_round; i++){ queue_free.push(std::unique_ptr<Batch>{ new Batch() }); }
+    auto cancel = [&](){ queue_free.cancel(); queue_batches.cancel(); queue_runs.cancel(); };
+
+    // the mapping is built by its own thread, reading the vertex file concurrently with the edge file
+    std::unique_ptr<VertexMapping> mapping;
+    std::promise<void> mapping_promise;
+    std::future<void> mapping_ready = mapping_promise.get_future();
+    std::thread mapping_thread = spawn("vertex-reader", [&](){
+        try {
+            mapping.reset(new VertexMapping{ reader, stable_order, result.m_dictionary });
+        } catch(...){
+            mapping_promise.set_exception(std::current_exception());
+            throw;
+        }
+        mapping_promise.set_value();
+    }, cancel);
+
+    std::thread reader_thread = spawn("reader", [&](){
+        ReportStage stage { "read-edges" };
+        std::unique_ptr<Batch> batch;
+        while(queue_free.pop(batch)){
+            TraceSpan span { "parse", "read-edges" };
+            batch->m_size = reader.read_edges(batch->m_sources.get(), batch->m_destinations.get(), batch->m_weights.get(), g_batch_size);
+            span.close();
+            if(batch->m_size == 0) break; // depleted
+            stage->m_num_edges += batch->m_size;
+            if(!queue_batches.push(std::move(batch))) break;
+        }
+        queue_batches.close();
+        stage->m_bytes_read = file_size(reader.get_path_edge_list());
+    }, cancel);
+
+    std::thread remapper_thread = spawn("remapper", [&](){
+        ReportStage stage { "remap-edges" };
+        result.m_edges.reserve(s_run_size + num_batches_per_round * g_batch_size);
+        std::vector<std::unique_ptr<Batch>> pending; // batches read and not remapped yet
+        std::unique_ptr<Batch> batch;
+        bool is_mapping_ready = false;
+        auto remap_pending = [&](){
+            remap_pending_edges<E, is_directed>(*mapping, pending, result);
+            for(auto& batch : pending){
+                stage->m_num_edges += batch->m_size;
+                queue_free.push(std::move(batch));
+            }
+            pending.clear();
+        };
+        auto complete_mapping = [&](){
+            mapping_ready.get(); // rethrow the error of the mapping thread, if any
+            is_mapping_ready = true;
+            LOG("Vertex mapping complete, batches of edges pending: " << pending.size());
+            remap_pending();
+        };
+
+        while(queue_batches.pop(batch)){
+            pending.push_back(std::move(batch));
+            if(!is_mapping_ready && mapping_ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+                complete_mapping();
+            } else if(!is_mapping_ready){ // retain the batch, and give the reader a new one
+                queue_free.push(std::unique_ptr<Batch>{ new Batch() });
+            } else if(pending.size() >= num_batches_per_round){
+                remap_pending();
+            }
+
+            if(result.m_edges.size() >= s_run_size){ // hand over the run to the sorter
+                Edges run;
+                run.reserve(s_run_size + num_batches_per_round * g_batch_size);
+                std::swap(run, result.m_edges);
+                if(!queue_runs.push(std::make_pair(std::move(run), std::exchange(result.m_runs, EdgeRuns{})))) break;
+            }
+        }
+        if(queue_batches.is_cancelled()) return;
+        if(!is_mapping_ready){ complete_mapping(); } // all edges read before the mapping was complete
+        if(!pending.empty()){ remap_pending(); } // the last round
+        if(queue_batches.is_cancelled()) return;
+        if(!result.m_edges.empty()){
+            queue_runs.push(std::make_pair(std::move(result.m_edges), std::exchange(result.m_runs, EdgeRuns{})));
+            result.m_edges = Edges{};
+        }
+        queue_runs.close();
+
+        result.m_num_vertices = mapping->num_vertices(); // number of vertices created
+        mapping->finalise(algorithms);
+        stage->m_num_vertices = result.m_num_vertices;
+        stage->m_dictionary = result.m_dictionary;
+    }, cancel);
+
+    std::thread sorter_thread = spawn("sorter", [&](){
+        ReportStage stage { "sort-runs" };
+        std::pair<Edges, EdgeRuns> run;
+        while(queue_runs.pop(run)){
+            TraceSpan span { "sort", "sort-run" };
+            adaptive_sort(run.first.data(), run.first.size(), run.second, g_num_sort_threads, g_low_memory);
+            stage->m_num_edges += run.first.size();
+            m_runs.push_back(std::move(run.first));
+            run.first = Edges{};
+        }
+    }, cancel);
+
+    mapping_thread.join();
+    reader_thread.join();
+    remapper_thread.join();
+    sorter_thread.join();
+    rethrow_if_error();
+
+    timer.stop();
+    LOG("Input edges parsed and sorted in " << m_runs.size() << " runs in " << timer);
+    mapping->log();
+
+    return result;
+}
+
+template<typename E, bool is_directed>
+uint64_t OverlappedPipeline<E, is_directed>::num_edges() const {
+    uint64_t result = 0;
+    for(auto& run : m_runs){ result += run.size(); }
+    return result;
+}
+
+template<typename E, bool is_directed>
+void OverlappedPipeline<E, is_directed>::save(uint64_t num_vertices, const std::vector<OutputFormat>& formats, const std::string& path_prefix, std::vector<WeightEncoder>& encoders){
+    assert(formats.size() == encoders.size() && "Expected one encoder for each format");
+    for(auto format : formats){ LOG("Saving the edge file " << path_edge_file(format, path_prefix) << " ..."); }
+    common::Timer timer; timer.start();
+
+    // a single merger, feeding the serialisers of all formats
+    const uint64_t num_formats = formats.size();
+    std::vector<std::unique_ptr<Chunk>> chunks; // owner of the chunks
+    BoundedQueue<Chunk*> queue_free { s_num_chunks }; // empty chunks, or consumed by all serialisers
+    std::vector<std::unique_ptr<BoundedQueue<Chunk*>>> queues_chunks; // merger -> serialiser of each format
+    for(uint64_t i = 0; i < s_num_chunks; i++){
+        chunks.emplace_back(new Chunk());
+        chunks.back()->m_edges.reserve(s_chunk_size);
+        queue_free.push(chunks.back().get());
+    }
+    for(uint64_t i = 0; i < num_formats; i++){ queues_chunks.emplace_back(new BoundedQueue<Chunk*>(s_num_chunks)); }
+    auto cancel = [&](){ queue_free.cancel(); for(auto& queue : queues_chunks){ queue->cancel(); } };
+
+    std::vector<std::thread> threads;
+    for(uint64_t i = 0; i < num_formats; i++){
+        const OutputFormat format = formats[i];
+        BoundedQueue<Chunk*>& queue_chunks = *queues_chunks[i];
+        WeightEncoder& encoder = encoders[i];
+        const std::string path_vertices = path_vertex_file(format, path_prefix);
+        const std::string path_edges = path_edge_file(format, path_prefix);
+
+        switch(format){
+        case OutputFormat::PLAIN:
+            threads.push_back(spawn("vertex-writer", [=](){ save_vertices<false>(num_vertices, path_vertices); }, cancel));
+            threads.push_back(spawn("formatter", [&, path_edges](){ serialise<false>(queue_chunks, queue_free, encoder, path_edges); }, cancel));
+            break;
+        case OutputFormat::ZLIB:
+            threads.push_back(spawn("vertex-writer", [=](){ save_vertices<true>(num_vertices, path_vertices); }, cancel));
+            threads.push_back(spawn("compressor", [&, path_edges](){ serialise<true>(queue_chunks, queue_free, encoder, path_edges); }, cancel));
+            break;
+        case OutputFormat::CSR:
+            threads.push_back(spawn("csr-writer", [&, path_edges](){ serialise_csr(queue_chunks, queue_free, encoder, path_edges, num_vertices); }, cancel));
+            break;
+        }
+    }
+    threads.push_back(spawn("merger", [&](){ merge(queue_free, queues_chunks); }, cancel));
+
+    for(auto& thread : threads){ thread.join(); }
+    m_runs.clear();
+    rethrow_if_error();
+
+    timer.stop();
+    LOG("Edge file saved in " << timer);
+}
+
+template<typename E, bool is_directed>
+void OverlappedPipeline<E, is_directed>::merge(BoundedQueue<Chunk*>& queue_free, std::vector<std::unique_ptr<BoundedQueue<Chunk*>>>& queues_chunks){
+    ReportStage stage { "merge-runs" };
+    const uint64_t num_edges = this->num_edges();
+    EdgeOrder order;
+
+    // min heap over the head of each run
+    std::vector<Cursor> heap;
+    for(auto& run : m_runs){
+        if(!run.empty()){ heap.push_back(Cursor{ run.data(), run.data() + run.size() }); }
+    }
+    auto greater = [&](const Cursor& c1, const Cursor& c2){ return order(*c2.m_current, *c1.m_current); };
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    uint64_t num_edges_merged = 0;
+    do {
+        Chunk* chunk = nullptr;
+        if(!queue_free.pop(chunk)) return; // cancelled
+        TraceSpan span { "merge", "merge-runs" };
+        chunk->m_edges.clear();
+
+        while(chunk->m_edges.size() < s_chunk_size && !heap.empty()){
+            if(heap.size() == 1){ // the last run, copy the remaining edges as they are
+                Cursor& c = heap[0];
+                uint64_t count = std::min<uint64_t>(c.m_end - c.m_current, s_chunk_size - chunk->m_edges.size());
+                chunk->m_edges.insert(chunk->m_edges.end(), c.m_current, c.m_current + count);
+                c.m_current += count;
+                if(c.m_current == c.m_end){ heap.pop_back(); }
+            } else {
+                std::pop_heap(heap.begin(), heap.end(), greater);
+                Cursor& c = heap.back();
+                chunk->m_edges.push_back(*(c.m_current++));
+                if(c.m_current == c.m_end){
+                    heap.pop_back();
+                } else {
+                    std::push_heap(heap.begin(), heap.end(), greater);
+                }
+            }
+        }
+
+        num_edges_merged += chunk->m_edges.size();
+        chunk->m_last = (num_edges_merged >= num_edges);
+        chunk->m_num_readers = queues_chunks.size();
+        span.close();
+        for(auto& queue : queues_chunks){
+            if(!queue->push(chunk)) return; // cancelled
+        }
+    } while(num_edges_merged < num_edges);
+
+    for(auto& queue : queues_chunks){ queue->close(); }
+    stage->m_num_edges = num_edges_merged;
+}
+
+template<typename E, bool is_directed>
+void OverlappedPipeline<E, is_directed>::release(Chunk* chunk, BoundedQueue<Chunk*>& queue_free){
+    if(--chunk->m_num_readers == 0){ queue_free.push(chunk); }
+}
+
+template<typename E, bool is_directed>
+template<bool is_compressed>
+void OverlappedPipeline<E, is_directed>::serialise(BoundedQueue<Chunk*>& queue_chunks, BoundedQueue<Chunk*>& queue_free, WeightEncoder& encoder, const std::string& path_output){
+    ReportStage stage { is_compressed ? "compress-edges" : "format-edges" };
+    AsyncWriter out { path_output };
+    Chunk* chunk = nullptr;
+
+    if constexpr(is_compressed){ // the same input to zlib of save_edges, to obtain the same output
+        std::unique_ptr<uint64_t[]> ptr_input_buffer { new uint64_t[s_chunk_size * 3 /* src + dst + weight */ ] };
+        char* input_buffer = reinterpret_cast<char*>(ptr_input_buffer.get());
+
+        z_stream stream; int rc (0);
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        stream.avail_in = 0;
+        stream.avail_out = 0;
+        rc = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+        if(rc != Z_OK) ERROR("Cannot initialise the zlib stream");
+
+        while(queue_chunks.pop(chunk)){
+            TraceSpan span { "compress", "deflate" };
+            uint64_t bytes_serialised = serialise_edges(chunk->m_edges.data(), chunk->m_edges.size(), encoder, input_buffer);
+            stage->m_num_edges += chunk->m_edges.size();
+            const int flush = chunk->m_last ? Z_FINISH : Z_NO_FLUSH;
+            release(chunk, queue_free);
+
+            stream.next_in = reinterpret_cast<decltype(stream.next_in)>(input_buffer);
+            stream.avail_in = bytes_serialised;
+            do { // compress directly into the buffers of the writer
+                const uint64_t available = std::min<uint64_t>(out.available(), std::numeric_limits<uInt>::max());
+                stream.avail_out = available;
+                stream.next_out = reinterpret_cast<unsigned char*>(out.data());
+                rc = deflate(&stream, flush);
+                if(rc != Z_OK && rc != Z_STREAM_END) ERROR("Compression error");
+                out.advance(available - stream.avail_out);
+            } while(stream.avail_in > 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+        }
+
+        rc = deflateEnd(&stream);
+        if(rc != Z_OK && rc != Z_DATA_ERROR /* cancelled */) ERROR("Cannot close the zlib stream");
+
+    } else { // plain output
+        std::ostringstream ss;
+        while(queue_chunks.pop(chunk)){
+            TraceSpan span { "compress", "format" };
+            ss.str("");
+            const Edges& edges = chunk->m_edges;
+            for(uint64_t i = 0, sz = edges.size(); i < sz; i++){
+                ss << edges[i].source() << " " << edges[i].destination();
+                if constexpr(has_weight<E>){
+                    ss << " ";
+                    encoder.print(ss, edges[i].weight());
+                }
+                ss << "\n";
+            }
+            stage->m_num_edges += edges.size();
+            release(chunk, queue_free);
+            out.write(ss.str());
+        }
+    }
+
+    if(queue_chunks.is_cancelled()) return; // the writer removes the truncated file
+    out.close();
+    stage->m_bytes_written = out.bytes_written();
+}
+
+template<typename E, bool is_directed>
+void OverlappedPipeline<E, is_directed>::serialise_csr(BoundedQueue<Chunk*>& queue_chunks, BoundedQueue<Chunk*>& queue_free, WeightEncoder& encoder, const std::string& path_output, uint64_t num_vertices){
+    ReportStage stage { "save-csr" };
+    CsrWriter out { path_output, num_vertices, has_weight<E> ? encoder.width() : 0 };
+    Chunk* chunk = nullptr;
+    while(queue_chunks.pop(chunk)){
+        TraceSpan span { "compress", "csr" };
+        out.append(chunk->m_edges.data(), chunk->m_edges.size(), encoder);
+        stage->m_num_edges += chunk->m_edges.size();
+        release(chunk, queue_free);
+    }
+
+    if(queue_chunks.is_cancelled()) return; // the writer removes the truncated file
+    out.close();
+    stage->m_num_vertices = num_vertices;
+    stage->m_bytes_written = out.bytes_written();
+}
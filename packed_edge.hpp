@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+#include "edge.hpp"
+#include "parallel_sort.hpp"
+
+/**
+ * An edge with its source and destination packed into a single 64 bit key, source in the upper half, so that the
+ * order of the keys is the order of the edges by source and destination. The weight, if any, is carried as payload.
+ * The packed edges are 8 (Edge), 16 (WeightedEdge) and 12 bytes (CompactWeightedEdge) rather than 16, 24 and 20
+ * bytes, fitting in the storage of the edges, and they are compared with a single integer comparison. Only applicable when all vertex IDs fit in 32 bits.
+ */
+template<typename E> struct PackedEdge;
+
+template<>
+struct PackedEdge<Edge> {
+    uint64_t m_key;
+};
+
+template<>
+struct PackedEdge<WeightedEdge> {
+    uint64_t m_key;
+    double m_weight;
+};
+
+#pragma pack(push, 4)
+template<>
+struct PackedEdge<CompactWeightedEdge> {
+    uint64_t m_key;
+    float m_weight;
+};
+#pragma pack(pop)
+
+// order of the packed edges, the same of EdgeOrder for the unpacked edges
+struct PackedEdgeOrder {
+    template<typename P>
+    bool operator()(const P& e1, const P& e2) const { return e1.m_key < e2.m_key; }
+};
+
+/**
+ * Sort the edges by source and destination, packing them into PackedEdges in place, in the same storage of the
+ * edges, sorting the packed edges and unpacking them back. No memory is required besides the array of the edges.
+ * Return false, without altering the array, when a vertex ID does not fit in 32 bits.
+ */
+template<typename E>
+bool sort_edges_packed(E* edges, uint64_t num_edges, uint64_t num_threads){
+    using P = PackedEdge<E>;
+    static_assert(sizeof(P) < sizeof(E), "The packed edges must fit in the storage of the edges");
+    static_assert(alignof(P) <= alignof(E), "The packed edges must be aligned as the edges");
+    static_assert(std::is_trivially_destructible_v<E> && std::is_trivially_copyable_v<P>, "The objects are replaced without being destroyed");
+    constexpr uint64_t max_vertex_id = std::numeric_limits<uint32_t>::max();
+    for(uint64_t i = 0; i < num_edges; i++){
+        if(edges[i].m_source > max_vertex_id || edges[i].m_destination > max_vertex_id) return false;
+    }
+
+    // The packed edge i overlaps only the edges [0, i], as a packed edge is smaller than an edge. Packing from the
+    // front, each edge is read before its storage is reused. Placement new starts the lifetime of the packed edges,
+    // ending that of the edges overlapped, and std::launder obtains a pointer to the new objects.
+    unsigned char* storage = reinterpret_cast<unsigned char*>(edges);
+    { // pack
+        TraceSpan span { "sort", "pack" };
+        for(uint64_t i = 0; i < num_edges; i++){
+            const E edge = edges[i];
+            P* packed = new (storage + i * sizeof(P)) P;
+            packed->m_key = (edge.m_source << 32) | edge.m_destination;
+            if constexpr(!std::is_same_v<E, Edge>){ packed->m_weight = edge.m_weight; }
+        }
+    }
+    P* packed_edges = std::launder(reinterpret_cast<P*>(storage));
+
+    parallel_sort(packed_edges, packed_edges + num_edges, PackedEdgeOrder{}, num_threads);
+
+    // Symmetrically, the edge i overlaps only the packed edges from i onwards, they are unpacked from the back. The
+    // edges are recreated at their original addresses, hence the pointer `edges' refers to the new objects.
+    { // unpack
+        TraceSpan span { "sort", "unpack" };
+        for(uint64_t i = num_edges; i-- > 0; ){
+            const P packed = packed_edges[i];
+            E* edge = new (storage + i * sizeof(E)) E;
+            edge->m_source = packed.m_key >> 32;
+            edge->m_destination = packed.m_key & max_vertex_id;
+            if constexpr(!std::is_same_v<E, Edge>){ edge->m_weight = packed.m_weight; }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,212 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "random.hpp"
+#include "tracer.hpp"
+#include "work_stealing_pool.hpp"
+
+/**
+ * Parallel in-place sample sort, for any comparator. A range is partitioned into up to 64 buckets, delimited by
+ * splitters picked from a random sample, and each bucket is then sorted recursively, as an independent task of a
+ * work stealing pool, until it is small enough for std::sort. The partition of the whole array is the only step
+ * that cannot be split into independent tasks: its classification, the comparisons against the splitters, is
+ * executed by all threads, while the permutation of the elements in their buckets, a single pass of swaps, is
+ * sequential. The extra memory is one byte per element, the bucket of each element computed by the classification.
+ */
+template<typename T, typename Compare>
+class ParallelSampleSort {
+    static constexpr uint64_t s_num_buckets = 64; // max number of buckets in a partition
+    static constexpr uint64_t s_oversampling = 16; // sampled elements for each bucket
+    static constexpr uint64_t s_base_case = (1ull << 16); // ranges smaller than this are sorted with std::sort
+    static constexpr uint64_t s_max_depth = 8; // give up partitioning, e.g. with many equal elements
+    static constexpr uint64_t s_classify_stripe = (1ull << 20); // elements classified by each task at the top level
+
+    T* const m_array; // the whole array
+    const uint64_t m_size; // number of elements in the array
+    Compare m_comp; // the order of the elements
+    std::unique_ptr<uint8_t[]> m_oracle; // the bucket of each element
+    std::unique_ptr<WorkStealingPool> m_pool; // the threads sorting the buckets
+
+    // splitters of a partition, the buckets are (-inf, s_0], (s_0, s_1], ..., (s_{k-2}, +inf)
+    struct Splitters {
+        std::vector<T> m_values;
+        uint64_t num_buckets() const { return m_values.size() +1; }
+    };
+
+    // pick the splitters of the range [first, last), from a random sample
+    Splitters sample(T* first, T* last) const {
+        const uint64_t size = last - first;
+        const uint64_t num_samples = s_num_buckets * s_oversampling;
+        Philox4x32 random { /* seed */ size };
+        std::vector<T> samples;
+        samples.reserve(num_samples);
+        for(uint64_t i = 0; i < num_samples; i++){
+            samples.push_back(first[ random(first - m_array, i) % size ]);
+        }
+        std::sort(samples.begin(), samples.end(), m_comp);
+
+        Splitters result;
+        for(uint64_t i = s_oversampling; i < num_samples; i += s_oversampling){
+            // skip the duplicates, an empty bucket between two equal splitters is useless
+            if(result.m_values.empty() || m_comp(result.m_values.back(), samples[i])){
+                result.m_values.push_back(samples[i]);
+            }
+        }
+        return result;
+    }
+
+    // store the bucket of each element in [first, last) in the oracle and count the elements in each bucket
+    void classify(const Splitters& splitters, T* first, T* last, uint64_t* counts) const {
+        const T* begin = splitters.m_values.data();
+        const T* end = begin + splitters.m_values.size();
+        uint8_t* oracle = m_oracle.get() + (first - m_array);
+        for(T* it = first; it < last; it++){
+            uint8_t bucket = std::lower_bound(begin, end, *it, m_comp) - begin;
+            oracle[it - first] = bucket;
+            counts[bucket]++;
+        }
+    }
+
+    // move the elements of [first, last) into their buckets, according to the oracle. The array `bounds' contains the
+    // start of each bucket, followed by the end of the range.
+    void permute(T* first, const std::vector<uint64_t>& bounds) const {
+        TraceSpan span { "sort", "permute" };
+        uint8_t* oracle = m_oracle.get() + (first - m_array);
+        const uint64_t num_buckets = bounds.size() -1;
+        std::vector<uint64_t> heads (bounds.begin(), bounds.end() -1); // the next position to fill in each bucket
+        for(uint64_t b = 0; b < num_buckets; b++){
+            while(heads[b] < bounds[b +1]){
+                uint64_t i = heads[b];
+                uint8_t target = oracle[i];
+                if(target == b){
+                    heads[b]++;
+                } else { // swap the element into its bucket, the element coming back is examined in the next iteration
+                    uint64_t j = heads[target]++;
+                    std::swap(first[i], first[j]);
+                    std::swap(oracle[i], oracle[j]);
+                }
+            }
+        }
+    }
+
+    // the start of each bucket, followed by the end of the range, from the number of elements in each bucket
+    static std::vector<uint64_t> prefix_sum(const std::vector<uint64_t>& counts){
+        std::vector<uint64_t> bounds (counts.size() +1, 0);
+        for(uint64_t b = 0; b < counts.size(); b++){ bounds[b +1] = bounds[b] + counts[b]; }
+        return bounds;
+    }
+
+    // sort the range [first, last), either directly or by partitioning it and spawning a task for each bucket
+    void sort_range(T* first, T* last, uint64_t depth){
+        const uint64_t size = last - first;
+        if(size <= s_base_case || depth >= s_max_depth){
+            TraceSpan span { "sort", "sort-bucket" };
+            std::sort(first, last, m_comp);
+            return;
+        }
+
+        Splitters splitters = sample(first, last);
+        std::vector<uint64_t> counts (splitters.num_buckets(), 0);
+        { TraceSpan span { "sort", "classify" }; classify(splitters, first, last, counts.data()); }
+        if(*std::max_element(counts.begin(), counts.end()) == size){ // all elements fell in the same bucket
+            std::sort(first, last, m_comp);
+            return;
+        }
+        std::vector<uint64_t> bounds = prefix_sum(counts);
+        permute(first, bounds);
+        spawn(first, bounds, depth +1);
+    }
+
+    // sort each bucket of a partition, the small buckets immediately, the others in their own task
+    void spawn(T* first, const std::vector<uint64_t>& bounds, uint64_t depth){
+        for(uint64_t b = 0; b +1 < bounds.size(); b++){
+            T* bucket_first = first + bounds[b];
+            T* bucket_last = first + bounds[b +1];
+            if(bucket_last - bucket_first <= 1){
+                continue;
+            } else if(static_cast<uint64_t>(bucket_last - bucket_first) <= s_base_case){
+                sort_range(bucket_first, bucket_last, depth);
+            } else {
+                m_pool->submit([this, bucket_first, bucket_last, depth](){ sort_range(bucket_first, bucket_last, depth); });
+            }
+        }
+    }
+
+public:
+    ParallelSampleSort(T* first, T* last, Compare comp) : m_array(first), m_size(last - first), m_comp(comp) { }
+
+    /**
+     * Sort the array with the given number of threads
+     */
+    void sort(uint64_t num_threads){
+        if(num_threads <= 1 || m_size <= s_base_case){
+            std::sort(m_array, m_array + m_size, m_comp);
+            return;
+        }
+
+        m_oracle.reset(new uint8_t[m_size]);
+        m_pool.reset(new WorkStealingPool(num_threads, "sort-worker"));
+
+        // partition the whole array, classifying the stripes in parallel
+        Splitters splitters = sample(m_array, m_array + m_size);
+        const uint64_t num_stripes = (m_size + s_classify_stripe -1) / s_classify_stripe;
+        std::vector<std::vector<uint64_t>> stripe_counts (num_stripes, std::vector<uint64_t>(splitters.num_buckets(), 0));
+        for(uint64_t i = 0; i < num_stripes; i++){
+            m_pool->submit([this, &splitters, &stripe_counts, i](){
+                TraceSpan span { "sort", "classify" };
+                T* first = m_array + i * s_classify_stripe;
+                T* last = m_array + std::min(m_size, (i +1) * s_classify_stripe);
+                classify(splitters, first, last, stripe_counts[i].data());
+            });
+        }
+        m_pool->wait();
+        std::vector<uint64_t> counts (splitters.num_buckets(), 0);
+        for(auto& stripe : stripe_counts){
+            for(uint64_t b = 0; b < counts.size(); b++){ counts[b] += stripe[b]; }
+        }
+
+        if(*std::max_element(counts.begin(), counts.end()) == m_size){ // all elements fell in the same bucket
+            std::sort(m_array, m_array + m_size, m_comp);
+        } else {
+            std::vector<uint64_t> bounds = prefix_sum(counts);
+            permute(m_array, bounds);
+            spawn(m_array, bounds, 1);
+            m_pool->wait();
+        }
+
+        m_pool.reset();
+        m_oracle.reset();
+    }
+};
+
+/**
+ * Sort the range [first, last) with the given comparator and number of threads, see ParallelSampleSort
+ */
+template<typename T, typename Compare>
+void parallel_sort(T* first, T* last, Compare comp, uint64_t num_threads){
+    ParallelSampleSort<T, Compare> sorter { first, last, comp };
+    sorter.sort(num_threads);
+}
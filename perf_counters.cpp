@@ -0,0 +1,193 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+PerfMonitor g_perf;
+
+/*****************************************************************************
+ *                                                                           *
+ *  PerfSample                                                               *
+ *                                                                           *
+ *****************************************************************************/
+
+const char* to_string(PerfEvent event){
+    switch(event){
+    case PerfEvent::CYCLES: return "cycles";
+    case PerfEvent::INSTRUCTIONS: return "instructions";
+    case PerfEvent::LLC_MISSES: return "llc-misses";
+    case PerfEvent::DTLB_MISSES: return "dtlb-misses";
+    case PerfEvent::BRANCH_MISSES: return "branch-misses";
+    case PerfEvent::PAGE_FAULTS: return "page-faults";
+    default: return "unknown";
+    }
+}
+
+bool PerfSample::empty() const {
+    for(uint32_t i = 0; i < g_num_perf_events; i++){
+        if(m_valid[i]) return false;
+    }
+    return true;
+}
+
+PerfSample PerfSample::operator-(const PerfSample& start) const {
+    PerfSample result;
+    for(uint32_t i = 0; i < g_num_perf_events; i++){
+        result.m_valid[i] = m_valid[i] && start.m_valid[i];
+        result.m_values[i] = result.m_valid[i] && m_values[i] >= start.m_values[i] ? m_values[i] - start.m_values[i] : 0;
+    }
+    return result;
+}
+
+ostream& operator<<(ostream& out, const PerfSample& sample){
+    bool first = true;
+    for(uint32_t i = 0; i < g_num_perf_events; i++){
+        PerfEvent event = static_cast<PerfEvent>(i);
+        if(!sample.has(event)) continue;
+        if(!first) out << ", ";
+        out << to_string(event) << ": " << sample.get(event);
+        if(event == PerfEvent::INSTRUCTIONS && sample.has(PerfEvent::CYCLES) && sample.get(PerfEvent::CYCLES) > 0){
+            auto flags = out.flags();
+            out << " (IPC: " << fixed << setprecision(2) << static_cast<double>(sample.get(PerfEvent::INSTRUCTIONS)) / sample.get(PerfEvent::CYCLES) << ")";
+            out.flags(flags);
+        }
+        first = false;
+    }
+    if(first) out << "no counters available";
+    return out;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  PerfMonitor                                                              *
+ *                                                                           *
+ *****************************************************************************/
+
+// Configuration of the given event for perf_event_open
+static void get_attributes(PerfEvent event, perf_event_attr& attr){
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING; // to scale multiplexed counters
+
+    constexpr uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch(event){
+    case PerfEvent::CYCLES:
+        attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case PerfEvent::INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case PerfEvent::LLC_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_LL | read_miss; break;
+    case PerfEvent::DTLB_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_DTLB | read_miss; break;
+    case PerfEvent::BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case PerfEvent::PAGE_FAULTS:
+        attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_PAGE_FAULTS; break;
+    }
+}
+
+PerfMonitor::PerfMonitor(){
+
+}
+
+PerfMonitor::~PerfMonitor(){
+    for(auto& counters : m_threads){
+        for(uint32_t i = 0; i < g_num_perf_events; i++){
+            if(counters->m_fds[i] >= 0) ::close(counters->m_fds[i]);
+        }
+    }
+}
+
+void PerfMonitor::enable(){
+    m_enabled = true;
+}
+
+// the counters of the current thread, for g_perf
+static thread_local void* t_counters = nullptr;
+
+PerfMonitor::ThreadCounters* PerfMonitor::get_thread_counters(){
+    if(t_counters != nullptr) return reinterpret_cast<ThreadCounters*>(t_counters);
+
+    unique_ptr<ThreadCounters> counters { new ThreadCounters() };
+    string errors;
+    for(uint32_t i = 0; i < g_num_perf_events; i++){
+        perf_event_attr attr;
+        get_attributes(static_cast<PerfEvent>(i), attr);
+        // pid = 0 & cpu = -1, the calling thread on any cpu
+        counters->m_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if(counters->m_fds[i] < 0){
+            errors += string(errors.empty() ? "" : ", ") + to_string(static_cast<PerfEvent>(i)) + " (" + strerror(errno) + ")";
+        }
+    }
+
+    scoped_lock<mutex> lock(m_mutex);
+    if(!errors.empty() && !m_warned){
+        cerr << "[perf] Counters not available: " << errors << endl;
+        m_warned = true;
+    }
+    counters->m_thread_name = "thread-" + to_string(m_threads.size() +1);
+    t_counters = counters.get();
+    m_threads.push_back(move(counters));
+    return reinterpret_cast<ThreadCounters*>(t_counters);
+}
+
+PerfSample PerfMonitor::read(const ThreadCounters* counters){
+    PerfSample sample;
+    for(uint32_t i = 0; i < g_num_perf_events; i++){
+        if(counters->m_fds[i] < 0) continue;
+        uint64_t buffer[3]; // value, time enabled, time running
+        if(::read(counters->m_fds[i], buffer, sizeof(buffer)) != sizeof(buffer)) continue;
+        double scale = (buffer[2] > 0 && buffer[2] < buffer[1]) ? static_cast<double>(buffer[1]) / buffer[2] : 1.0;
+        sample.m_values[i] = static_cast<uint64_t>(buffer[0] * scale);
+        sample.m_valid[i] = true;
+    }
+    return sample;
+}
+
+PerfSample PerfMonitor::sample(){
+    if(!is_enabled()) return PerfSample{};
+    return read(get_thread_counters());
+}
+
+void PerfMonitor::set_thread_name(const string& name){
+    if(!is_enabled()) return;
+    ThreadCounters* counters = get_thread_counters();
+    scoped_lock<mutex> lock(m_mutex);
+    counters->m_thread_name = name;
+}
+
+vector<pair<string, PerfSample>> PerfMonitor::sample_all_threads(){
+    scoped_lock<mutex> lock(m_mutex);
+    vector<pair<string, PerfSample>> result;
+    for(auto& counters : m_threads){
+        result.emplace_back(counters->m_thread_name, read(counters.get()));
+    }
+    return result;
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The hardware events sampled for each stage of the pipeline
+ */
+enum class PerfEvent : uint32_t {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,
+    DTLB_MISSES,
+    BRANCH_MISSES,
+    PAGE_FAULTS, // software event, usually available even when the hardware counters are not
+};
+constexpr uint32_t g_num_perf_events = 6;
+
+/**
+ * Short name of the event, e.g. cycles or llc-misses
+ */
+const char* to_string(PerfEvent event);
+
+/**
+ * The value of the counters at a given instant, or the difference between two instants
+ */
+struct PerfSample {
+    uint64_t m_values[g_num_perf_events] = {}; // the counts, scaled when the counters have been multiplexed
+    bool m_valid[g_num_perf_events] = {}; // whether the counter is available
+
+    // Retrieve the count of the given event
+    uint64_t get(PerfEvent event) const { return m_values[static_cast<uint32_t>(event)]; }
+
+    // Check whether the given event has been counted
+    bool has(PerfEvent event) const { return m_valid[static_cast<uint32_t>(event)]; }
+
+    // Check whether any event has been counted
+    bool empty() const;
+
+    // The counts between two samples
+    PerfSample operator-(const PerfSample& start) const;
+};
+
+/**
+ * Print the sample in one line, e.g. cycles: 1000, instructions: 2000 (IPC: 2.00), ...
+ */
+std::ostream& operator<<(std::ostream& out, const PerfSample& sample);
+
+/**
+ * Hardware performance counters, through perf_event_open, for each thread of the program. The counters of a thread
+ * are opened on its first sample and keep counting, in user space, until the end of the program. The events that
+ * cannot be opened, e.g. in virtual machines or with restrictive settings in /proc/sys/kernel/perf_event_paranoid,
+ * are reported as unavailable, without interrupting the execution.
+ */
+class PerfMonitor {
+    struct ThreadCounters {
+        std::string m_thread_name; // name of the thread, in the summary
+        int m_fds[g_num_perf_events]; // file descriptors of the counters, or -1 when not available
+    };
+
+    std::atomic<bool> m_enabled { false }; // whether to sample the counters
+    std::mutex m_mutex; // to register the threads
+    std::vector<std::unique_ptr<ThreadCounters>> m_threads; // the counters of the threads that have been sampled
+    bool m_warned = false; // whether the events not available have been already reported
+
+    // Retrieve the counters of the calling thread, opening them on the first invocation
+    ThreadCounters* get_thread_counters();
+
+    // Read the current value of the counters
+    static PerfSample read(const ThreadCounters* counters);
+
+public:
+    /**
+     * Create the monitor, disabled
+     */
+    PerfMonitor();
+
+    /**
+     * Close the counters
+     */
+    ~PerfMonitor();
+
+    /**
+     * Start sampling the counters
+     */
+    void enable();
+
+    /**
+     * Check whether the counters are sampled
+     */
+    bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * Read the counters of the calling thread
+     */
+    PerfSample sample();
+
+    /**
+     * Set the name of the calling thread in the summary
+     */
+    void set_thread_name(const std::string& name);
+
+    /**
+     * Read the counters of all threads sampled, as pairs <thread name, counts since the first sample>
+     */
+    std::vector<std::pair<std::string, PerfSample>> sample_all_threads();
+};
+
+/**
+ * The monitor of the program
+ */
+extern PerfMonitor g_perf;
@@ -0,0 +1,177 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline.hpp"
+
+#include <charconv>
+#include <limits>
+#include <sched.h>
+#include <thread>
+
+using namespace common;
+using namespace std;
+
+mutex g_mutex_log;
+uint64_t g_num_sort_threads = num_available_cores();
+bool g_low_memory = false;
+
+uint64_t num_available_cores(){
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    if(sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0){
+        return std::max<uint64_t>(1, CPU_COUNT(&cpuset));
+    } else {
+        return std::max<uint64_t>(1, thread::hardware_concurrency());
+    }
+}
+
+void log_dictionary(const DictionaryStatistics& stats, uint64_t expected_num_vertices){
+    LOG(stats);
+    if(stats.m_num_rehashes > 0 || stats.m_num_entries > expected_num_vertices){
+        LOG("Warning: the property meta.vertices (" << expected_num_vertices << ") underestimates the number of vertices in the graph (" << stats.m_num_entries << "), "
+                "the dictionary has been resized " << stats.m_num_rehashes << " times");
+    } else if(stats.m_num_entries < expected_num_vertices / 2){
+        LOG("Warning: the property meta.vertices (" << expected_num_vertices << ") overestimates the number of vertices in the graph (" << stats.m_num_entries << ")");
+    }
+    if(stats.is_skewed()){
+        LOG("Warning: the distribution of the vertex IDs defeats the hash function of the dictionary, empty buckets: " << stats.m_empty_buckets
+                << " (expected: " << stats.m_expected_empty_buckets << ")");
+    }
+}
+
+OutputFormat output_format_from_string(const string& name){
+    if(name == "plain" || name == "text"){
+        return OutputFormat::PLAIN;
+    } else if(name == "zlib"){
+        return OutputFormat::ZLIB;
+    } else if(name == "csr"){
+        return OutputFormat::CSR;
+    } else {
+        INVALID_ARGUMENT("Invalid output format: `" << name << "'. Expected: plain, zlib or csr");
+    }
+}
+
+string to_string(OutputFormat format){
+    switch(format){
+    case OutputFormat::PLAIN: return "plain";
+    case OutputFormat::ZLIB: return "zlib";
+    case OutputFormat::CSR: return "csr";
+    }
+    return "unknown";
+}
+
+ostream& operator<<(ostream& out, OutputFormat format){
+    out << to_string(format);
+    return out;
+}
+
+string path_vertex_file(OutputFormat format, const string& path_prefix){
+    switch(format){
+    case OutputFormat::PLAIN: return path_prefix + ".v";
+    case OutputFormat::ZLIB: return path_prefix + ".vz";
+    case OutputFormat::CSR: return ""; // implicit in the offsets
+    }
+    return "";
+}
+
+string path_edge_file(OutputFormat format, const string& path_prefix){
+    switch(format){
+    case OutputFormat::PLAIN: return path_prefix + ".e";
+    case OutputFormat::ZLIB: return path_prefix + ".ez";
+    case OutputFormat::CSR: return path_prefix + ".csr";
+    }
+    return "";
+}
+
+template<bool is_compressed>
+void save_vertices(uint64_t num_vertices, const string& path_output){
+    LOG("Saving the vertex file " << path_output << " ...");
+    ReportStage stage { "save-vertices" };
+    Timer timer; timer.start();
+
+    AsyncWriter out { path_output };
+
+    if constexpr(is_compressed){ // compressed output
+        constexpr uint64_t buffer_sz = (1 << 20); // * sizeof(uint64_t)
+        unique_ptr<uint64_t[]> ptr_input_buffer { new uint64_t[buffer_sz] };
+        uint64_t* input_buffer = ptr_input_buffer.get();
+        uint64_t next_vertex_id = 0;
+
+        z_stream stream; int rc (0);
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        stream.avail_in = 0;
+        stream.avail_out = 0;
+        rc = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+        if(rc != Z_OK) ERROR("Cannot initialise the zlib stream");
+
+        do {
+            // input, the data that has to be compressed
+            if(stream.avail_in == 0){
+                uint64_t chunk_sz = min(num_vertices - next_vertex_id, buffer_sz);
+                for(uint64_t i = 0; i < chunk_sz; i++){
+                    input_buffer[i] = next_vertex_id +i;
+                }
+                next_vertex_id += chunk_sz;
+
+                stream.next_in = reinterpret_cast<decltype(stream.next_in)>(input_buffer);
+                stream.avail_in = chunk_sz * sizeof(uint64_t);
+            }
+
+            // output, zlib compresses directly into the buffer of the writer
+            const uint64_t available = min<uint64_t>(out.available(), numeric_limits<uInt>::max());
+            stream.avail_out = available;
+            stream.next_out = reinterpret_cast<unsigned char*>(out.data());
+
+            // invoke zlib
+            TraceSpan span_compress { "compress", "deflate" };
+            rc = deflate(&stream, (next_vertex_id >= num_vertices) ? Z_FINISH : Z_NO_FLUSH);
+            if(rc != Z_OK && rc != Z_STREAM_END) ERROR("Compression error");
+            span_compress.close();
+
+            // submit the buffer to the disk once full
+            TraceSpan span_write { "write", "write" };
+            out.advance(available - stream.avail_out);
+        } while(rc != Z_STREAM_END); // Z_FINISH may need more than one buffer to flush the stream
+
+        rc = deflateEnd(&stream);
+        if(rc != Z_OK) ERROR("Cannot close the zlib stream");
+
+    } else { // plain output
+        constexpr uint64_t buffer_sz = (1 << 16);
+        char buffer[buffer_sz];
+        uint64_t buffer_pos = 0;
+        for(uint64_t i = 0; i < num_vertices; i++){
+            if(buffer_pos + 32 > buffer_sz){ out.write(buffer, buffer_pos); buffer_pos = 0; }
+            buffer_pos = to_chars(buffer + buffer_pos, buffer + buffer_sz, i).ptr - buffer;
+            buffer[buffer_pos++] = '\n';
+        }
+        out.write(buffer, buffer_pos);
+    }
+
+    out.close();
+    timer.stop();
+    stage->m_num_vertices = num_vertices;
+    stage->m_bytes_written = out.bytes_written();
+    stage.close();
+    LOG("Vertex file saved in " << timer);
+}
+
+// explicit instantiations
+template void save_vertices<true>(uint64_t num_vertices, const string& path_output);
+template void save_vertices<false>(uint64_t num_vertices, const string& path_output);
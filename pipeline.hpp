@@ -0,0 +1,628 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "lib/common/error.hpp"
+#include "lib/common/timer.hpp"
+#include "zlib.h"
+
+#include "adaptive_sort.hpp"
+#include "async_writer.hpp"
+#include "csr_writer.hpp"
+#include "dictionary_statistics.hpp"
+#include "edge.hpp"
+#include "graphalytics_algorithms.hpp"
+#include "graphalytics_reader.hpp"
+#include "report.hpp"
+#include "tracer.hpp"
+#include "vertex_mapping.hpp"
+#include "weight.hpp"
+#include "work_stealing_pool.hpp"
+
+/**
+ * The stages of the conversion: parse & remap the input graph, sort the edges, save the vertices & the edges.
+ * The stages are templates over the properties of the graph, whether it is weighted (the edge type E), directed or
+ * the output is compressed, so that each combination obtains its own instance without branches in the inner loops.
+ * The properties are resolved only once, in main, and the output format once for each writer, in save_graph.
+ */
+
+// logging, the time spent waiting for the mutex is shown in the trace
+#define LOG(msg) { std::unique_lock xlock_log(g_mutex_log, std::defer_lock); \
+    { TraceSpan xspan_log("lock", "g_mutex_log"); xlock_log.lock(); } \
+    std::cout << msg << std::endl; }
+extern std::mutex g_mutex_log;
+
+// number of edges or vertices fetched from the reader at the time
+constexpr uint64_t g_batch_size = (1ull << 14);
+
+// number of threads sorting the edges, by default all cores available to the process
+extern uint64_t g_num_sort_threads;
+
+// whether to minimise the peak memory, at the expense of the overlap among the stages
+extern bool g_low_memory;
+
+// whether the edges of type E carry a weight
+template<typename E>
+constexpr bool has_weight = !std::is_same_v<E, Edge>;
+
+/**
+ * A format of the output graph
+ */
+enum class OutputFormat {
+    PLAIN, // text, <name>.v and <name>.e
+    ZLIB, // binary, compressed with zlib, <name>.vz and <name>.ez
+    CSR, // binary compressed sparse rows, <name>.csr, see CsrWriter
+};
+
+/**
+ * Parse the name of an output format: plain, zlib or csr
+ */
+OutputFormat output_format_from_string(const std::string& name);
+
+/**
+ * Name of the output format
+ */
+std::string to_string(OutputFormat format);
+std::ostream& operator<<(std::ostream& out, OutputFormat format);
+
+/**
+ * The vertex file for the given format, e.g. <prefix>.vz, or the empty string if the format has no vertex file
+ */
+std::string path_vertex_file(OutputFormat format, const std::string& path_prefix);
+
+/**
+ * The edge file for the given format, e.g. <prefix>.ez
+ */
+std::string path_edge_file(OutputFormat format, const std::string& path_prefix);
+
+// the input graph, after the vertices have been remapped. The container of the edges is either a std::vector, with
+// the PolicyAllocator in the overlapped pipeline, or, in the low memory mode, a MappedVector.
+template<typename E, typename Edges = std::vector<E>>
+struct InputGraph {
+    uint64_t m_num_vertices = 0; // number of vertices created
+    Edges m_edges; // the remapped edges
+    EdgeRuns m_runs; // the natural runs of m_edges, to pick the strategy of the sort
+    double m_min_weight = std::numeric_limits<double>::max(); // the smallest weight among all edges
+    double m_max_weight = 0; // the greatest weight among all edges
+    double m_rounding_error = 0; // the max error introduced by storing the weights in memory
+    DictionaryStatistics m_dictionary; // operations on the vertex dictionary
+};
+
+// a batch of edges read from the input, in a columnar layout, with the original IDs of the vertices
+template<typename E>
+struct EdgeBatch {
+    std::unique_ptr<uint64_t[]> m_sources { new uint64_t[g_batch_size] };
+    std::unique_ptr<uint64_t[]> m_destinations { new uint64_t[g_batch_size] };
+    std::unique_ptr<double[]> m_weights { has_weight<E> ? new double[g_batch_size] : nullptr };
+    uint64_t m_size = 0; // number of edges in the batch
+};
+
+/**
+ * Number of cores the process is allowed to run on, according to its CPU affinity
+ */
+uint64_t num_available_cores();
+
+/**
+ * Read the input graph and remap its vertices into the dense domain [0, num_vertices). If stable_order is set, the
+ * vertices follow the same order of the vertex file, otherwise the order they first appear in the edge file, or the
+ * order of the IDs when they are contiguous. The structure of the mapping is selected from a scan of the vertex file,
+ * see VertexMapping. The mapping is built by a separate thread, reading the vertex file concurrently with the edge
+ * file. The batches of edges read meanwhile are retained until the mapping is complete, at most a few with
+ * g_low_memory.
+ */
+template<typename E, bool is_directed, typename Edges = std::vector<E>>
+InputGraph<E, Edges> parse_input(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, bool stable_order);
+
+/**
+ * Log the statistics of the dictionary and warn when the property meta.vertices or the distribution of the vertex IDs
+ * are inappropriate for the table
+ */
+void log_dictionary(const DictionaryStatistics& stats, uint64_t expected_num_vertices);
+
+/**
+ * Remap a batch of edges, given in a columnar layout, and append them to `output'. The argument weights is ignored
+ * when the edges are not weighted.
+ */
+template<typename E, bool is_directed, typename Edges>
+void remap_edges(VertexDictionary& vertices, uint64_t& next_vertex_id, const uint64_t* sources,
+        const uint64_t* destinations, const double* weights, uint64_t num_edges, InputGraph<E, Edges>& output);
+
+/**
+ * Remap a batch of edges with the given mapper, see VertexMapping
+ */
+template<typename E, bool is_directed, typename Mapper, typename Edges>
+void remap_edges_with(Mapper& mapper, const uint64_t* sources, const uint64_t* destinations, const double* weights,
+        uint64_t num_edges, InputGraph<E, Edges>& output);
+
+/**
+ * Remap the given batches of edges and append them to `output', in the same order. With g_num_sort_threads > 1, the
+ * IDs of the batches are translated in place, in parallel: directly if the mapper is pure, otherwise with
+ * remap_first_appearance. The content of the batches is undefined afterwards.
+ */
+template<typename E, bool is_directed, typename Edges>
+void remap_pending_edges(VertexMapping& mapping, std::vector<std::unique_ptr<EdgeBatch<E>>>& batches, InputGraph<E, Edges>& output);
+
+/**
+ * Remap the given batches with g_num_sort_threads threads and a mapper that assigns the IDs in the order the vertices
+ * first appear, e.g. DictionaryMapper. The IDs are exactly those assigned by the mapper processing the batches
+ * sequentially, at any number of threads:
+ * 1. each batch, a chunk, in parallel, lists the vertices without an ID in the order they first appear in the chunk;
+ * 2. the lists are merged in the order of (chunk, offset): the first occurrence of each vertex assigns its ID, as the
+ *    running count of the vertices discovered so far, that is, the prefix sum of the new vertices of each chunk;
+ * 3. each chunk, in parallel, translates its IDs in place, then the edges are appended to `output' in order.
+ */
+template<typename E, bool is_directed, typename Mapper, typename Edges>
+void remap_first_appearance(Mapper& mapper, std::vector<std::unique_ptr<EdgeBatch<E>>>& batches, InputGraph<E, Edges>& output);
+
+/**
+ * Sort the edges by source and destination, in place, with g_num_sort_threads threads. The strategy depends on the
+ * natural runs detected while remapping the edges, see adaptive_sort.
+ */
+template<typename E, typename Edges>
+void sort_edges(InputGraph<E, Edges>& graph);
+
+/**
+ * Store the vertices [0, num_vertices) in the given file
+ */
+template<bool is_compressed>
+void save_vertices(uint64_t num_vertices, const std::string& path_output);
+
+/**
+ * Store the edges in the given file
+ */
+template<typename E, bool is_compressed, typename Edges>
+void save_edges(const Edges& edges, const std::string& path_output, WeightEncoder& encoder);
+
+/**
+ * Store the graph in the compressed sparse row format
+ */
+template<typename Edges>
+void save_csr(const Edges& edges, uint64_t num_vertices, const std::string& path_output, WeightEncoder& encoder);
+
+/**
+ * Store the vertices and the edges in the given format, in the files returned by path_vertex_file / path_edge_file
+ */
+template<typename Edges>
+void save_graph(OutputFormat format, const Edges& edges, uint64_t num_vertices, const std::string& path_prefix, WeightEncoder& encoder);
+
+/**
+ * Serialise the edges in binary form, as expected in the compressed output, into the buffer `out'.
+ * Return the number of bytes written.
+ */
+template<typename E>
+uint64_t serialise_edges(const E* edges, uint64_t num_edges, WeightEncoder& encoder, char* out);
+
+/*****************************************************************************
+ *                                                                           *
+ *  Implementation                                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+template<typename E, bool is_directed, typename Edges>
+InputGraph<E, Edges> parse_input(GraphalyticsReader& reader, GraphalyticsAlgorithms& algorithms, bool stable_order){
+    assert(reader.is_directed() == is_directed && "Instance mismatch");
+    InputGraph<E, Edges> result;
+
+    // Build the mapping in a separate thread, reading the vertex file while this thread reads the edge file. The
+    // batches of edges read meanwhile retain the original IDs, they are remapped once the mapping is complete.
+    std::unique_ptr<VertexMapping> mapping;
+    std::exception_ptr mapping_error;
+    std::atomic<bool> mapping_done = false;
+    std::thread mapping_thread([&](){
+        g_tracer.set_thread_name("vertex-reader");
+        g_perf.set_thread_name("vertex-reader");
+        try {
+            mapping.reset(new VertexMapping{ reader, stable_order, result.m_dictionary });
+        } catch(...){
+            mapping_error = std::current_exception();
+        }
+        mapping_done = true;
+    });
+    // With multiple threads, the batches are also retained in rounds, to remap them in parallel
+    const uint64_t num_batches_per_round = g_num_sort_threads > 1 ? 4 * g_num_sort_threads : 1;
+    // In the low memory mode, the edge file is read ahead of the mapping only up to a few batches
+    constexpr uint64_t max_pending_low_memory = 16;
+    std::vector<std::unique_ptr<EdgeBatch<E>>> pending; // batches read and not remapped yet
+    std::vector<std::unique_ptr<EdgeBatch<E>>> free_batches; // batches already remapped, to be reused
+    auto remap_pending = [&](){
+        remap_pending_edges<E, is_directed>(*mapping, pending, result);
+        for(auto& batch : pending){ free_batches.push_back(std::move(batch)); }
+        pending.clear();
+    };
+    auto complete_mapping = [&](){
+        mapping_thread.join();
+        if(mapping_error){ std::rethrow_exception(mapping_error); }
+        LOG("Vertex mapping complete, batches of edges pending: " << pending.size());
+        remap_pending();
+    };
+
+    LOG("Reading the input edges ...");
+    ReportStage stage { "parse-edges" };
+    common::Timer timer; timer.start();
+
+    result.m_edges.reserve(std::stoull(reader.get_property("meta.edges")));
+
+    try {
+        std::unique_ptr<EdgeBatch<E>> batch { new EdgeBatch<E>() };
+        while(true){
+            TraceSpan span_read { "parse", "read-edges" };
+            batch->m_size = reader.read_edges(batch->m_sources.get(), batch->m_destinations.get(), batch->m_weights.get(), g_batch_size);
+            span_read.close();
+            if(batch->m_size == 0) break;
+
+            if(mapping_thread.joinable() && mapping_done){ complete_mapping(); }
+
+            if(mapping_thread.joinable() || num_batches_per_round > 1){ // retain the batch
+                pending.push_back(std::move(batch));
+                if(free_batches.empty()){
+                    batch.reset(new EdgeBatch<E>());
+                } else {
+                    batch = std::move(free_batches.back());
+                    free_batches.pop_back();
+                }
+                if(mapping_thread.joinable() && g_low_memory && pending.size() >= max_pending_low_memory){
+                    complete_mapping(); // wait for the mapping rather than retaining more batches
+                } else if(!mapping_thread.joinable() && pending.size() >= num_batches_per_round){
+                    remap_pending();
+                }
+            } else {
+                TraceSpan span_remap { "remap", "remap-edges" };
+                mapping->visit([&](auto& mapper){
+                    remap_edges_with<E, is_directed>(mapper, batch->m_sources.get(), batch->m_destinations.get(), batch->m_weights.get(), batch->m_size, result);
+                });
+            }
+        }
+        if(mapping_thread.joinable()){ complete_mapping(); } // all edges read before the mapping was complete
+        if(!pending.empty()){ remap_pending(); } // the last round
+    } catch(...){
+        if(mapping_thread.joinable()){ mapping_thread.join(); }
+        throw;
+    }
+
+    result.m_num_vertices = mapping->num_vertices(); // number of vertices created
+    mapping->finalise(algorithms);
+
+    timer.stop();
+    stage->m_bytes_read = file_size(reader.get_path_edge_list());
+    stage->m_num_vertices = result.m_num_vertices;
+    stage->m_num_edges = result.m_edges.size();
+    stage->m_dictionary = result.m_dictionary;
+    stage.close();
+    LOG("Input edges parsed in " << timer);
+    mapping->log();
+
+    return result;
+}
+
+template<typename E, bool is_directed, typename Edges>
+void remap_edges(VertexDictionary& vertices, uint64_t& next_vertex_id, const uint64_t* sources,
+        const uint64_t* destinations, const double* weights, uint64_t num_edges, InputGraph<E, Edges>& output){
+    DictionaryMapper mapper { vertices, next_vertex_id, output.m_dictionary };
+    remap_edges_with<E, is_directed>(mapper, sources, destinations, weights, num_edges, output);
+}
+
+template<typename E, bool is_directed, typename Mapper, typename Edges>
+void remap_edges_with(Mapper& mapper, const uint64_t* sources, const uint64_t* destinations, const double* weights,
+        uint64_t num_edges, InputGraph<E, Edges>& output){
+    // pure mappers translate the two columns upfront, to overlap the cache misses of the lookups
+    std::unique_ptr<uint64_t[]> translated;
+    if constexpr(is_batch_mapper<Mapper>){
+        translated.reset(new uint64_t[num_edges * 2]);
+        mapper.translate(sources, translated.get(), num_edges);
+        mapper.translate(destinations, translated.get() + num_edges, num_edges);
+    }
+
+    for(uint64_t i = 0; i < num_edges; i++){
+        E edge;
+
+        if constexpr(has_weight<E>){
+            double weight = weights[i];
+            edge.m_weight = weight; // it may be rounded to single precision
+            output.m_min_weight = std::min(output.m_min_weight, weight);
+            output.m_max_weight = std::max(output.m_max_weight, weight);
+            if constexpr(std::is_same_v<E, CompactWeightedEdge>){
+                output.m_rounding_error = std::max(output.m_rounding_error, std::fabs(weight - edge.m_weight));
+            }
+        }
+
+        uint64_t source, destination;
+        if constexpr(is_batch_mapper<Mapper>){
+            source = translated[i];
+            destination = translated[num_edges + i];
+        } else {
+            source = mapper(sources[i]);
+            destination = mapper(destinations[i]);
+        }
+
+        assert(source != destination && "Edge with the same source & destination is not allowed");
+        if constexpr(is_directed){
+            edge.m_source = source;
+            edge.m_destination = destination;
+        } else { // src < dst
+            edge.m_source = std::min(source, destination);
+            edge.m_destination = std::max(source, destination);
+        }
+
+        uint64_t position = output.m_edges.size();
+        output.m_runs.append(position > 0 ? &output.m_edges[position -1] : nullptr, edge, position);
+        output.m_edges.push_back(edge);
+    }
+}
+
+template<typename E, bool is_directed, typename Edges>
+void remap_pending_edges(VertexMapping& mapping, std::vector<std::unique_ptr<EdgeBatch<E>>>& batches, InputGraph<E, Edges>& output){
+    TraceSpan span { "remap", "remap-batches" };
+    mapping.visit([&](auto& mapper){
+        using Mapper = std::decay_t<decltype(mapper)>;
+        if constexpr(is_pure_mapper<Mapper>){
+            // translate the IDs in place, the batches are independent
+            auto translate = [&mapper](uint64_t* vertex_ids, uint64_t num_vertices){
+                if constexpr(is_batch_mapper<Mapper>){
+                    std::unique_ptr<uint64_t[]> translated { new uint64_t[num_vertices] };
+                    mapper.translate(vertex_ids, translated.get(), num_vertices);
+                    std::copy(translated.get(), translated.get() + num_vertices, vertex_ids);
+                } else {
+                    for(uint64_t i = 0; i < num_vertices; i++){ vertex_ids[i] = mapper(vertex_ids[i]); }
+                }
+            };
+            auto translate_batch = [&translate](EdgeBatch<E>* batch){
+                translate(batch->m_sources.get(), batch->m_size);
+                translate(batch->m_destinations.get(), batch->m_size);
+            };
+            if(g_num_sort_threads > 1 && batches.size() > 1){
+                WorkStealingPool pool { std::min<uint64_t>(g_num_sort_threads, batches.size()), "remap-worker" };
+                for(auto& batch : batches){
+                    pool.submit([&translate_batch, ptr = batch.get()](){ translate_batch(ptr); });
+                }
+                pool.wait();
+            } else {
+                for(auto& batch : batches){ translate_batch(batch.get()); }
+            }
+
+            IdentityMapper identity;
+            for(auto& batch : batches){
+                remap_edges_with<E, is_directed>(identity, batch->m_sources.get(), batch->m_destinations.get(), batch->m_weights.get(), batch->m_size, output);
+            }
+        } else if(g_num_sort_threads > 1 && batches.size() > 1){ // the mapper assigns new IDs
+            remap_first_appearance<E, is_directed>(mapper, batches, output);
+        } else { // the mapper assigns new IDs, in the order the edges were read
+            for(auto& batch : batches){
+                remap_edges_with<E, is_directed>(mapper, batch->m_sources.get(), batch->m_destinations.get(), batch->m_weights.get(), batch->m_size, output);
+            }
+        }
+    });
+}
+
+template<typename E, bool is_directed, typename Mapper, typename Edges>
+void remap_first_appearance(Mapper& mapper, std::vector<std::unique_ptr<EdgeBatch<E>>>& batches, InputGraph<E, Edges>& output){
+    const uint64_t num_chunks = batches.size();
+    WorkStealingPool pool { std::min<uint64_t>(g_num_sort_threads, num_chunks), "remap-worker" };
+
+    // 1. Local discovery, the vertices without an ID in the order they first appear in each chunk
+    std::vector<std::vector<uint64_t>> discovered ( num_chunks );
+    for(uint64_t chunk_id = 0; chunk_id < num_chunks; chunk_id++){
+        pool.submit([&mapper, batch = batches[chunk_id].get(), &vertices = discovered[chunk_id]](){
+            std::unordered_set<uint64_t> seen;
+            auto discover = [&](uint64_t vertex_id){
+                if(mapper.lookup(vertex_id) == g_vertex_not_found && seen.insert(vertex_id).second){ vertices.push_back(vertex_id); }
+            };
+            for(uint64_t i = 0; i < batch->m_size; i++){ // same order of the sequential remapping, source first
+                discover(batch->m_sources[i]);
+                discover(batch->m_destinations[i]);
+            }
+        });
+    }
+    pool.wait();
+
+    // 2. Merge by (chunk, offset). The mapper assigns the next ID to the first occurrence of each vertex, the next
+    // occurrences, in the following chunks, find the ID already assigned
+    uint64_t num_endpoints = 0;
+    uint64_t num_discovered = 0;
+    for(uint64_t chunk_id = 0; chunk_id < num_chunks; chunk_id++){
+        for(uint64_t vertex_id : discovered[chunk_id]){ mapper(vertex_id); }
+        num_discovered += discovered[chunk_id].size();
+        num_endpoints += 2 * batches[chunk_id]->m_size;
+    }
+    if constexpr(std::is_same_v<Mapper, DictionaryMapper>){ // the lookups of the first and the third phase
+        mapper.record_lookups(num_endpoints - num_discovered);
+    }
+
+    // 3. Translate the IDs in place, all vertices have been assigned
+    for(auto& batch : batches){
+        pool.submit([&mapper, ptr = batch.get()](){
+            auto translate = [&mapper](uint64_t* vertex_ids, uint64_t num_vertices){
+                for(uint64_t i = 0; i < num_vertices; i++){
+                    vertex_ids[i] = mapper.lookup(vertex_ids[i]);
+                    assert(vertex_ids[i] != g_vertex_not_found && "The vertex has been assigned in the merge");
+                }
+            };
+            translate(ptr->m_sources.get(), ptr->m_size);
+            translate(ptr->m_destinations.get(), ptr->m_size);
+        });
+    }
+    pool.wait();
+
+    IdentityMapper identity;
+    for(auto& batch : batches){
+        remap_edges_with<E, is_directed>(identity, batch->m_sources.get(), batch->m_destinations.get(), batch->m_weights.get(), batch->m_size, output);
+    }
+}
+
+template<typename E, typename Edges>
+void sort_edges(InputGraph<E, Edges>& graph){
+    Edges& edges = graph.m_edges;
+    LOG("Sorting the list of edges (natural runs: " << graph.m_runs.m_num_runs << ", strategy: " << choose_sort_strategy(graph.m_runs) << ") ...");
+    ReportStage stage { "sort" };
+    stage->m_num_edges = edges.size();
+    common::Timer timer; timer.start();
+
+    adaptive_sort(edges.data(), edges.size(), graph.m_runs, g_num_sort_threads, g_low_memory);
+
+    timer.stop();
+    LOG("Edges sorted in " << timer);
+}
+
+template<typename E>
+uint64_t serialise_edges(const E* edges, uint64_t num_edges, WeightEncoder& encoder, char* out){
+    const uint64_t increment = 2 * sizeof(uint64_t) + (has_weight<E> ? encoder.width() : 0); // bytes per edge
+    for(uint64_t i = 0, j = 0; i < num_edges; i++, j += increment){
+        uint64_t source = edges[i].source(), destination = edges[i].destination();
+        memcpy(out + j, &source, sizeof(uint64_t));
+        memcpy(out + j + sizeof(uint64_t), &destination, sizeof(uint64_t));
+        if constexpr(has_weight<E>){ encoder.encode(edges[i].m_weight, out + j + 2 * sizeof(uint64_t)); }
+    }
+    return num_edges * increment;
+}
+
+template<typename E, bool is_compressed, typename Edges>
+void save_edges(const Edges& edges, const std::string& path_output, WeightEncoder& encoder){
+    using namespace std;
+    LOG("Saving the edge file " << path_output << " ...");
+    ReportStage stage { "save-edges" };
+    common::Timer timer; timer.start();
+
+    AsyncWriter out { path_output };
+
+    if constexpr(is_compressed){ // compressed output
+        constexpr uint64_t buffer_sz (1 << 20); // * sizeof(uint64_t)
+        unique_ptr<uint64_t[]> ptr_input_buffer { new uint64_t[buffer_sz * 3 /* src + dst + weight */ ] };
+        char* input_buffer = reinterpret_cast<char*>(ptr_input_buffer.get());
+        uint64_t next_edge_id = 0;
+
+        z_stream stream; int rc (0);
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        stream.avail_in = 0;
+        stream.avail_out = 0;
+        rc = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+        if(rc != Z_OK) ERROR("Cannot initialise the zlib stream");
+
+        do {
+            // input, the data that has to be compressed
+            if(stream.avail_in == 0){
+                TraceSpan span { "compress", "serialise" };
+                uint64_t chunk_sz = min<uint64_t>(edges.size() - next_edge_id, buffer_sz);
+                uint64_t bytes_serialised = serialise_edges(edges.data() + next_edge_id, chunk_sz, encoder, input_buffer);
+                next_edge_id += chunk_sz;
+
+                stream.next_in = reinterpret_cast<decltype(stream.next_in)>(input_buffer);
+                stream.avail_in = bytes_serialised;
+            }
+
+            // output, zlib compresses directly into the buffer of the writer
+            const uint64_t available = min<uint64_t>(out.available(), numeric_limits<uInt>::max());
+            stream.avail_out = available;
+            stream.next_out = reinterpret_cast<unsigned char*>(out.data());
+
+            // invoke zlib
+            TraceSpan span_compress { "compress", "deflate" };
+            rc = deflate(&stream, (next_edge_id >= edges.size()) ? Z_FINISH : Z_NO_FLUSH);
+            if(rc != Z_OK && rc != Z_STREAM_END) ERROR("Compression error");
+            span_compress.close();
+
+            // submit the buffer to the disk once full
+            TraceSpan span_write { "write", "write" };
+            out.advance(available - stream.avail_out);
+        } while(rc != Z_STREAM_END); // Z_FINISH may need more than one buffer to flush the stream
+
+        rc = deflateEnd(&stream);
+        if(rc != Z_OK) ERROR("Cannot close the zlib stream");
+
+    } else { // plain output
+        constexpr uint64_t chunk_sz = (1 << 16); // edges formatted at the time
+        stringstream ss;
+        for(uint64_t i = 0, sz = edges.size(); i < sz; i++){
+            ss << edges[i].source() << " " << edges[i].destination();
+            if constexpr(has_weight<E>){
+                ss << " ";
+                encoder.print(ss, edges[i].weight());
+            }
+            ss << "\n";
+
+            if((i +1) % chunk_sz == 0 || i +1 == sz){
+                out.write(ss.str());
+                ss.str("");
+            }
+        }
+    }
+
+    out.close();
+    timer.stop();
+    stage->m_num_edges = edges.size();
+    stage->m_bytes_written = out.bytes_written();
+    stage.close();
+    LOG("Edge file saved in " << timer);
+}
+
+template<typename Edges>
+void save_csr(const Edges& edges, uint64_t num_vertices, const std::string& path_output, WeightEncoder& encoder){
+    using E = typename Edges::value_type;
+    LOG("Saving the CSR file " << path_output << " ...");
+    ReportStage stage { "save-csr" };
+    common::Timer timer; timer.start();
+
+    CsrWriter out { path_output, num_vertices, has_weight<E> ? encoder.width() : 0 };
+    out.append(edges.data(), edges.size(), encoder);
+    out.close();
+
+    timer.stop();
+    stage->m_num_vertices = num_vertices;
+    stage->m_num_edges = edges.size();
+    stage->m_bytes_written = out.bytes_written();
+    stage.close();
+    LOG("CSR file saved in " << timer);
+}
+
+template<typename Edges>
+void save_graph(OutputFormat format, const Edges& edges, uint64_t num_vertices, const std::string& path_prefix, WeightEncoder& encoder){
+    using E = typename Edges::value_type;
+    switch(format){
+    case OutputFormat::PLAIN:
+        save_vertices<false>(num_vertices, path_vertex_file(format, path_prefix));
+        save_edges<E, false>(edges, path_edge_file(format, path_prefix), encoder);
+        break;
+    case OutputFormat::ZLIB:
+        save_vertices<true>(num_vertices, path_vertex_file(format, path_prefix));
+        save_edges<E, true>(edges, path_edge_file(format, path_prefix), encoder);
+        break;
+    case OutputFormat::CSR:
+        save_csr(edges, num_vertices, path_edge_file(format, path_prefix), encoder);
+        break;
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counter-based random number generator Philox4x32-10, from J. K. Salmon et al, "Parallel random numbers: as easy
+ * as 1, 2, 3", SC 2011. The output is a pure function of the counter and the key, so that any thread can generate
+ * the value for any counter on its own, without sharing a state. The implementation consists only of integer
+ * multiplications and xors, the compiler is able to vectorise loops invoking it over independent counters.
+ */
+class Philox4x32 {
+    static constexpr uint32_t M0 = 0xD2511F53; // multipliers
+    static constexpr uint32_t M1 = 0xCD9E8D57;
+    static constexpr uint32_t W0 = 0x9E3779B9; // key schedule, golden ratio
+    static constexpr uint32_t W1 = 0xBB67AE85; // key schedule, sqrt(3) - 1
+    static constexpr int NUM_ROUNDS = 10;
+
+    uint32_t m_key0; // first half of the key
+    uint32_t m_key1; // second half of the key
+
+public:
+    /**
+     * Initialise the generator with the given seed, used as key
+     */
+    Philox4x32(uint64_t seed = 0) : m_key0(static_cast<uint32_t>(seed)), m_key1(static_cast<uint32_t>(seed >> 32)) { }
+
+    /**
+     * Generate 128 random bits from the counter (c0, c1). Only the first 64 bits are returned
+     */
+    uint64_t operator()(uint64_t c0, uint64_t c1) const {
+        uint32_t x0 = static_cast<uint32_t>(c0), x1 = static_cast<uint32_t>(c0 >> 32);
+        uint32_t x2 = static_cast<uint32_t>(c1), x3 = static_cast<uint32_t>(c1 >> 32);
+        uint32_t k0 = m_key0, k1 = m_key1;
+
+        for(int i = 0; i < NUM_ROUNDS; i++){
+            uint64_t p0 = static_cast<uint64_t>(M0) * x0;
+            uint64_t p1 = static_cast<uint64_t>(M1) * x2;
+            uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x1 ^ k0;
+            uint32_t y1 = static_cast<uint32_t>(p1);
+            uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x3 ^ k1;
+            uint32_t y3 = static_cast<uint32_t>(p0);
+            x0 = y0; x1 = y1; x2 = y2; x3 = y3;
+            k0 += W0; k1 += W1; // bump the key
+        }
+
+        return (static_cast<uint64_t>(x1) << 32) | x0;
+    }
+};
@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "rank_bitmap.hpp"
+
+#include "memory_policy.hpp"
+
+using namespace std;
+
+RankBitmap::RankBitmap(uint64_t size) : m_size(size) {
+    // the pages of an anonymous mapping are zeroed, that is, all bits are unset
+    m_bitmap = static_cast<uint64_t*>(map_memory(num_words(m_size) * sizeof(uint64_t)));
+    try {
+        m_directory = static_cast<uint64_t*>(map_memory(num_blocks(m_size) * 2 * sizeof(uint64_t)));
+    } catch(...){
+        unmap_memory(m_bitmap, num_words(m_size) * sizeof(uint64_t));
+        throw;
+    }
+}
+
+RankBitmap::~RankBitmap(){
+    unmap_memory(m_bitmap, num_words(m_size) * sizeof(uint64_t));
+    unmap_memory(m_directory, num_blocks(m_size) * 2 * sizeof(uint64_t));
+}
+
+void RankBitmap::build_directory(){
+    const uint64_t nwords = num_words(m_size);
+    const uint64_t nblocks = num_blocks(m_size);
+    uint64_t absolute = 0;
+    for(uint64_t block = 0; block < nblocks; block++){
+        uint64_t relative = 0; // 9 bits for each word but the first, whose relative rank is always 0
+        uint64_t count = 0;
+        for(uint64_t i = 0; i < 8; i++){
+            if(i > 0){ relative |= count << ((i -1) * 9); }
+            uint64_t word = block * 8 + i;
+            if(word < nwords){ count += __builtin_popcountll(m_bitmap[word]); }
+        }
+        m_directory[block * 2] = absolute;
+        m_directory[block * 2 +1] = relative;
+        absolute += count;
+    }
+    m_num_bits_set = absolute;
+}
+
+uint64_t RankBitmap::footprint() const {
+    return (num_words(m_size) + num_blocks(m_size) * 2) * sizeof(uint64_t);
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+/**
+ * A bitmap over the domain [0, size), with a directory to compute the rank of a position, that is, the number of bits
+ * set before it, in constant time. The directory follows the layout of rank9 (S. Vigna, Broadword implementation of
+ * rank/select queries, 2008): for each block of 512 bits, a pair of words stores the absolute rank at the start of the
+ * block and the relative ranks of its words 1..7, packed in 9 bits each. A rank query reads one entry of the directory
+ * and one word of the bitmap, at most two cache misses, and executes a single popcount.
+ *
+ * The bitmap and the directory are anonymous memory mappings, subject to the global memory policy. Set all bits first,
+ * then invoke #build_directory() before the first call to #rank().
+ */
+class RankBitmap {
+    RankBitmap(const RankBitmap&) = delete;
+    RankBitmap& operator=(const RankBitmap&) = delete;
+
+    const uint64_t m_size; // number of bits
+    uint64_t* m_bitmap = nullptr; // the bits, 64 per word
+    uint64_t* m_directory = nullptr; // for each block of 512 bits, the absolute rank and the packed relative ranks
+    uint64_t m_num_bits_set = 0; // total number of bits set, computed by build_directory
+
+    static constexpr uint64_t num_words(uint64_t size){ return (size + 63) / 64; }
+    static constexpr uint64_t num_blocks(uint64_t size){ return (size + 511) / 512; }
+
+public:
+    /**
+     * Create a bitmap of `size' bits, all unset
+     */
+    RankBitmap(uint64_t size);
+
+    /**
+     * Release the bitmap and the directory
+     */
+    ~RankBitmap();
+
+    /**
+     * Set the bit at the given position
+     */
+    void set(uint64_t position){
+        assert(position < m_size && "Out of bounds");
+        m_bitmap[position / 64] |= (uint64_t) 1 << (position % 64);
+    }
+
+    /**
+     * Check whether the bit at the given position is set
+     */
+    bool test(uint64_t position) const {
+        assert(position < m_size && "Out of bounds");
+        return (m_bitmap[position / 64] >> (position % 64)) & 1;
+    }
+
+    /**
+     * Compute the ranks of the directory, once all bits have been set
+     */
+    void build_directory();
+
+    /**
+     * The number of bits set in [0, position)
+     */
+    uint64_t rank(uint64_t position) const {
+        assert(position < m_size && "Out of bounds");
+        const uint64_t word = position / 64;
+        const uint64_t* entry = m_directory + (word / 8) * 2;
+        // relative rank of the word inside the block. The relative ranks of the words 1..7 are stored at the bits
+        // 9 * (word - 1); for the word 0, t + 8 = 7 selects the bit 63, which is always unset
+        const uint64_t t = (word % 8) -1;
+        uint64_t result = entry[0] + ((entry[1] >> ((t + ((t >> 60) & 8)) * 9)) & 0x1FF);
+        result += __builtin_popcountll( m_bitmap[word] & (((uint64_t) 1 << (position % 64)) -1) );
+        return result;
+    }
+
+    /**
+     * Size of the domain, in bits
+     */
+    uint64_t size() const { return m_size; }
+
+    /**
+     * Total number of bits set, available after #build_directory()
+     */
+    uint64_t count() const { return m_num_bits_set; }
+
+    /**
+     * Amount of memory used by the bitmap and the directory, in bytes
+     */
+    uint64_t footprint() const;
+};
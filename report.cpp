@@ -0,0 +1,249 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "report.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "lib/common/error.hpp"
+
+using namespace std;
+
+Report g_report;
+
+/*****************************************************************************
+ *                                                                           *
+ *  Report                                                                   *
+ *                                                                           *
+ *****************************************************************************/
+
+// Encode the given string as a JSON literal
+static string to_json(const string& value){
+    stringstream ss;
+    ss << '"';
+    for(char c : value){
+        switch(c){
+        case '"': ss << "\\\""; break;
+        case '\\': ss << "\\\\"; break;
+        case '\n': ss << "\\n"; break;
+        case '\t': ss << "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20){
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                ss << buffer;
+            } else {
+                ss << c;
+            }
+        }
+    }
+    ss << '"';
+    return ss.str();
+}
+
+static string to_json(double value){
+    stringstream ss;
+    ss << setprecision(9) << value;
+    return ss.str();
+}
+
+void Report::set_json(const string& key, const string& value){
+    scoped_lock<mutex> lock(m_mutex);
+    for(auto& p : m_properties){
+        if(p.first == key){ p.second = value; return; }
+    }
+    m_properties.emplace_back(key, value);
+}
+
+void Report::set(const string& key, const string& value){
+    set_json(key, to_json(value));
+}
+
+void Report::set(const string& key, const char* value){
+    set_json(key, to_json(string(value)));
+}
+
+void Report::set(const string& key, bool value){
+    set_json(key, value ? "true" : "false");
+}
+
+void Report::set(const string& key, uint64_t value){
+    set_json(key, to_string(value));
+}
+
+void Report::set(const string& key, double value){
+    set_json(key, to_json(value));
+}
+
+void Report::add(const StageStatistics& stage){
+    scoped_lock<mutex> lock(m_mutex);
+    m_stages.push_back(stage);
+}
+
+void Report::set_threads(const vector<pair<string, PerfSample>>& threads){
+    scoped_lock<mutex> lock(m_mutex);
+    m_threads = threads;
+}
+
+void Report::print_counters(ostream& out) const {
+    scoped_lock<mutex> lock(m_mutex);
+    out << "Hardware counters per stage:\n";
+    for(auto& s : m_stages){
+        out << "  " << s.m_name << ": " << s.m_counters << "\n";
+    }
+    out << "Hardware counters per thread:\n";
+    for(auto& t : m_threads){
+        out << "  " << t.first << ": " << t.second << "\n";
+    }
+}
+
+// Encode the counters as a JSON object, the events not available are null
+static string to_json(const PerfSample& sample){
+    stringstream ss;
+    ss << "{";
+    for(uint32_t i = 0; i < g_num_perf_events; i++){
+        PerfEvent event = static_cast<PerfEvent>(i);
+        ss << (i > 0 ? ", " : "") << "\"" << to_string(event) << "\": ";
+        if(sample.has(event)){ ss << sample.get(event); } else { ss << "null"; }
+    }
+    ss << "}";
+    return ss.str();
+}
+
+// Encode the statistics of the dictionary as a JSON object
+static string to_json(const DictionaryStatistics& stats){
+    stringstream ss;
+    ss << "{\"lookups\": " << stats.m_num_lookups << ", \"inserts\": " << stats.m_num_inserts << ", \"hit_rate\": " << to_json(stats.hit_rate())
+       << ", \"rehashes\": " << stats.m_num_rehashes << ", \"buckets\": " << stats.m_num_buckets << ", \"buckets_sampled\": " << stats.m_num_buckets_sampled
+       << ", \"empty_buckets\": " << to_json(stats.m_empty_buckets) << ", \"expected_empty_buckets\": " << to_json(stats.m_expected_empty_buckets)
+       << ", \"mean_probe_length\": " << to_json(stats.m_mean_probe_length) << ", \"max_probe_length\": " << stats.m_max_probe_length
+       << ", \"probe_histogram\": [";
+    for(uint64_t i = 0; i < stats.m_probe_histogram.size(); i++){
+        ss << (i > 0 ? ", " : "") << stats.m_probe_histogram[i];
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+void Report::save(const string& path) const {
+    scoped_lock<mutex> lock(m_mutex);
+    fstream out { path, ios::out };
+    if(!out.good()) ERROR("Cannot create the file `" << path << "'");
+
+    out << "{\n";
+    for(auto& p : m_properties){
+        out << "  " << to_json(p.first) << ": " << p.second << ",\n";
+    }
+    out << "  \"stages\": [";
+    for(uint64_t i = 0; i < m_stages.size(); i++){
+        const StageStatistics& s = m_stages[i];
+        double edges_per_second = s.m_wall_time > 0 ? s.m_num_edges / s.m_wall_time : 0;
+        double mb_per_second = s.m_wall_time > 0 ? (s.m_bytes_read + s.m_bytes_written) / s.m_wall_time / (1ull << 20) : 0;
+        out << (i > 0 ? "," : "") << "\n    {";
+        out << "\"name\": " << to_json(s.m_name) << ", ";
+        out << "\"wall_time\": " << to_json(s.m_wall_time) << ", ";
+        out << "\"cpu_time\": " << to_json(s.m_cpu_time) << ", ";
+        out << "\"bytes_read\": " << s.m_bytes_read << ", ";
+        out << "\"bytes_written\": " << s.m_bytes_written << ", ";
+        out << "\"vertices\": " << s.m_num_vertices << ", ";
+        out << "\"edges\": " << s.m_num_edges << ", ";
+        out << "\"edges_per_second\": " << to_json(edges_per_second) << ", ";
+        out << "\"mb_per_second\": " << to_json(mb_per_second) << ", ";
+        out << "\"peak_rss\": " << s.m_peak_rss << ", ";
+        out << "\"dictionary_size\": " << s.m_dictionary.m_num_entries << ", ";
+        out << "\"dictionary_load_factor\": " << to_json(s.m_dictionary.m_load_factor);
+        if(s.m_dictionary.m_num_lookups > 0){ out << ", \"dictionary\": " << to_json(s.m_dictionary); }
+        if(!s.m_counters.empty()){ out << ", \"counters\": " << to_json(s.m_counters); }
+        out << "}";
+    }
+    out << "\n  ]";
+    if(!m_threads.empty()){
+        out << ",\n  \"threads\": [";
+        for(uint64_t i = 0; i < m_threads.size(); i++){
+            out << (i > 0 ? "," : "") << "\n    {\"name\": " << to_json(m_threads[i].first) << ", \"counters\": " << to_json(m_threads[i].second) << "}";
+        }
+        out << "\n  ]";
+    }
+    out << "\n";
+    out << "}\n";
+
+    out.close();
+    if(!out) ERROR("Cannot write the report into `" << path << "'");
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  ReportStage                                                              *
+ *                                                                           *
+ *****************************************************************************/
+
+ReportStage::ReportStage(const char* name) : m_span("stage", name), m_wall_start(chrono::steady_clock::now()), m_cpu_start(get_cpu_time()), m_counters_start(g_perf.sample()) {
+    m_stats.m_name = name;
+}
+
+ReportStage::~ReportStage(){
+    close();
+}
+
+void ReportStage::close(){
+    if(m_closed) return;
+    m_closed = true;
+    m_span.close();
+    m_stats.m_wall_time = chrono::duration<double>(chrono::steady_clock::now() - m_wall_start).count();
+    m_stats.m_cpu_time = get_cpu_time() - m_cpu_start;
+    m_stats.m_peak_rss = get_peak_rss();
+    if(g_perf.is_enabled()){ m_stats.m_counters = g_perf.sample() - m_counters_start; }
+    g_report.add(m_stats);
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  Resource usage                                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+double get_cpu_time(){
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+uint64_t get_peak_rss(){
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // KB
+}
+
+string to_string_bytes(uint64_t bytes){
+    const char* units[] = { "bytes", "KB", "MB", "GB", "TB" };
+    double value = bytes; int unit = 0;
+    while(value >= 1024 && unit < 4){ value /= 1024; unit++; }
+    stringstream ss;
+    ss << fixed << setprecision(unit == 0 ? 0 : 1) << value << " " << units[unit];
+    return ss.str();
+}
+
+uint64_t file_size(const string& path){
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) return 0;
+    return st.st_size;
+}
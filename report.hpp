@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dictionary_statistics.hpp"
+#include "perf_counters.hpp"
+#include "tracer.hpp"
+
+/**
+ * Statistics of a single stage of the pipeline
+ */
+struct StageStatistics {
+    std::string m_name; // e.g. parse-edges, sort, save-edges
+    double m_wall_time = 0; // seconds
+    double m_cpu_time = 0; // seconds, user + system time of all threads in the process
+    uint64_t m_bytes_read = 0; // bytes read from the input files
+    uint64_t m_bytes_written = 0; // bytes written to the output files
+    uint64_t m_num_vertices = 0; // vertices processed
+    uint64_t m_num_edges = 0; // edges processed
+    uint64_t m_peak_rss = 0; // peak resident set size of the process at the end of the stage, in bytes
+    DictionaryStatistics m_dictionary; // operations on the vertex dictionary, if used in the stage
+    PerfSample m_counters; // hardware counters of the thread executing the stage, if sampled
+};
+
+/**
+ * Machine readable report of a run, in JSON. It consists of a set of global properties (e.g. input graph, hostname)
+ * and the statistics of each stage, in the order they completed.
+ */
+class Report {
+    mutable std::mutex m_mutex; // the stages may complete in different threads
+    std::vector<std::pair<std::string, std::string>> m_properties; // key, value already encoded in JSON
+    std::vector<StageStatistics> m_stages;
+    std::vector<std::pair<std::string, PerfSample>> m_threads; // hardware counters of each thread, if sampled
+
+    // Set the property with the value already encoded in JSON
+    void set_json(const std::string& key, const std::string& value);
+
+public:
+    /**
+     * Set a global property of the report
+     */
+    void set(const std::string& key, const std::string& value);
+    void set(const std::string& key, const char* value);
+    void set(const std::string& key, bool value);
+    void set(const std::string& key, uint64_t value);
+    void set(const std::string& key, double value);
+
+    /**
+     * Append the statistics of a completed stage
+     */
+    void add(const StageStatistics& stage);
+
+    /**
+     * Set the hardware counters of the threads, as pairs <thread name, counts>
+     */
+    void set_threads(const std::vector<std::pair<std::string, PerfSample>>& threads);
+
+    /**
+     * Print the hardware counters of each stage and each thread, in a human readable form
+     */
+    void print_counters(std::ostream& out) const;
+
+    /**
+     * Save the report in the given path, in JSON
+     */
+    void save(const std::string& path) const;
+};
+
+/**
+ * The report of the current run
+ */
+extern Report g_report;
+
+/**
+ * Measure a stage of the pipeline, from its construction until close() is invoked, and add its statistics to g_report.
+ * The counters not related to time (bytes, edges, dictionary) are set by the stage itself, through operator->.
+ * The stage is also recorded as a span in the trace, if enabled.
+ */
+class ReportStage {
+    StageStatistics m_stats;
+    TraceSpan m_span; // the whole stage, in the trace
+    std::chrono::steady_clock::time_point m_wall_start; // when the stage started
+    double m_cpu_start; // CPU time of the process when the stage started
+    PerfSample m_counters_start; // hardware counters when the stage started
+    bool m_closed = false; // whether the stage has already been added to the report
+
+public:
+    /**
+     * Start measuring the stage with the given name, a static string
+     */
+    ReportStage(const char* name);
+
+    /**
+     * Close the stage, if not already done
+     */
+    ~ReportStage();
+
+    /**
+     * Stop measuring the stage and add it to the report
+     */
+    void close();
+
+    /**
+     * Access the statistics of the stage
+     */
+    StageStatistics* operator->() { return &m_stats; }
+};
+
+/**
+ * CPU time of the process, user + system, in seconds
+ */
+double get_cpu_time();
+
+/**
+ * Peak resident set size of the process, in bytes
+ */
+uint64_t get_peak_rss();
+
+/**
+ * Format the given number of bytes, e.g. 12.3 GB
+ */
+std::string to_string_bytes(uint64_t bytes);
+
+/**
+ * Size of the given file, in bytes, or 0 if it does not exist
+ */
+uint64_t file_size(const std::string& path);
@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tracer.hpp"
+
+#include <fstream>
+#include <iomanip>
+
+#include "lib/common/error.hpp"
+
+using namespace std;
+
+Tracer g_tracer;
+
+// the buffer of the current thread, for g_tracer
+static thread_local Tracer::ThreadBuffer* t_buffer = nullptr;
+
+Tracer::Tracer() : m_epoch(chrono::steady_clock::now()) {
+
+}
+
+void Tracer::enable(){
+    m_enabled = true;
+}
+
+Tracer::ThreadBuffer* Tracer::get_thread_buffer(){
+    if(t_buffer == nullptr){
+        unique_ptr<ThreadBuffer> buffer { new ThreadBuffer() };
+        buffer->m_events.reset(new Event[s_capacity]);
+
+        scoped_lock<mutex> lock(m_mutex);
+        buffer->m_thread_id = m_buffers.size() +1;
+        buffer->m_thread_name = "thread-" + to_string(buffer->m_thread_id);
+        t_buffer = buffer.get();
+        m_buffers.push_back(move(buffer));
+    }
+    return t_buffer;
+}
+
+void Tracer::record(const char* category, const char* name, uint64_t start, uint64_t end){
+    ThreadBuffer* buffer = get_thread_buffer();
+    uint64_t position = buffer->m_num_events.load(memory_order_relaxed); // single writer
+    buffer->m_events[position & (s_capacity -1)] = Event{ category, name, start, end };
+    buffer->m_num_events.store(position +1, memory_order_release);
+}
+
+void Tracer::set_thread_name(const string& name){
+    if(!is_enabled()) return;
+    ThreadBuffer* buffer = get_thread_buffer();
+    scoped_lock<mutex> lock(m_mutex);
+    buffer->m_thread_name = name;
+}
+
+void Tracer::save(const string& path){
+    scoped_lock<mutex> lock(m_mutex);
+    fstream out { path, ios::out };
+    if(!out.good()) ERROR("Cannot create the file `" << path << "'");
+    out << fixed << setprecision(3);
+
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    for(auto& buffer : m_buffers){
+        out << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->m_thread_id << ", \"args\": {\"name\": \"" << buffer->m_thread_name << "\"}}";
+        first = false;
+
+        uint64_t num_events = buffer->m_num_events.load(memory_order_acquire);
+        uint64_t start = num_events > s_capacity ? num_events - s_capacity : 0;
+        for(uint64_t i = start; i < num_events; i++){
+            const Event& e = buffer->m_events[i & (s_capacity -1)];
+            out << ",\n{\"name\": \"" << e.m_name << "\", \"cat\": \"" << e.m_category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->m_thread_id
+                << ", \"ts\": " << (e.m_start / 1000.0) << ", \"dur\": " << ((e.m_end - e.m_start) / 1000.0) << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    out.close();
+    if(!out) ERROR("Cannot write the trace into `" << path << "'");
+}
@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Event tracer, to visualise the timeline of the threads in the Chrome trace viewer (chrome://tracing) or Perfetto.
+ * Each thread records its spans in its own ring buffer, without locks, which is registered with the tracer on the
+ * first event. When the ring buffer is full, the oldest events are overwritten. When the tracer is not enabled, a
+ * span costs a single load and branch.
+ */
+class Tracer {
+public:
+    // A single span, the timestamps are in nanoseconds since the tracer has been created
+    struct Event {
+        const char* m_category; // static string
+        const char* m_name; // static string
+        uint64_t m_start;
+        uint64_t m_end;
+    };
+
+    // The events of a single thread
+    struct ThreadBuffer {
+        uint64_t m_thread_id; // sequential id, in order of registration
+        std::string m_thread_name; // name shown in the viewer
+        std::unique_ptr<Event[]> m_events; // ring buffer
+        std::atomic<uint64_t> m_num_events {0}; // total number of events recorded, including those overwritten
+    };
+
+    static constexpr uint64_t s_capacity = (1ull << 16); // max number of events retained per thread, power of 2
+
+private:
+    std::atomic<bool> m_enabled { false }; // whether to record the events
+    const std::chrono::steady_clock::time_point m_epoch; // origin of the timestamps
+    std::mutex m_mutex; // to register the threads
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers; // one for each thread that recorded an event
+
+    // Retrieve the buffer of the calling thread, registering it if this is its first event
+    ThreadBuffer* get_thread_buffer();
+
+public:
+    /**
+     * Create the tracer, disabled
+     */
+    Tracer();
+
+    /**
+     * Start recording the events
+     */
+    void enable();
+
+    /**
+     * Check whether the tracer is recording
+     */
+    bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * Current timestamp, in nanoseconds
+     */
+    uint64_t now() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count(); }
+
+    /**
+     * Record a span in the buffer of the calling thread. The category and the name must be static strings.
+     */
+    void record(const char* category, const char* name, uint64_t start, uint64_t end);
+
+    /**
+     * Set the name of the calling thread in the trace
+     */
+    void set_thread_name(const std::string& name);
+
+    /**
+     * Save the events recorded in the Chrome trace format (JSON). The threads should not record any other
+     * event in the meanwhile.
+     */
+    void save(const std::string& path);
+};
+
+/**
+ * The tracer of the program
+ */
+extern Tracer g_tracer;
+
+/**
+ * Record a span from its construction to its destruction, or until close() is invoked
+ */
+class TraceSpan {
+    const char* m_category;
+    const char* m_name;
+    uint64_t m_start;
+    bool m_enabled;
+
+public:
+    TraceSpan(const char* category, const char* name) : m_category(category), m_name(name), m_start(0), m_enabled(g_tracer.is_enabled()) {
+        if(m_enabled){ m_start = g_tracer.now(); }
+    }
+
+    ~TraceSpan(){ close(); }
+
+    void close(){
+        if(m_enabled){
+            g_tracer.record(m_category, m_name, m_start, g_tracer.now());
+            m_enabled = false;
+        }
+    }
+};
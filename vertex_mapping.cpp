@@ -0,0 +1,261 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vertex_mapping.hpp"
+
+#include <memory>
+
+#include "lib/common/timer.hpp"
+#include "graphalytics_algorithms.hpp"
+#include "graphalytics_reader.hpp"
+#include "memory_policy.hpp"
+#include "pipeline.hpp"
+#include "report.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+VertexRange scan_vertices(GraphalyticsReader& reader){
+    LOG("Scanning the input vertices ...");
+    ReportStage stage { "scan-vertices" };
+    common::Timer timer; timer.start();
+
+    VertexRange range;
+    unique_ptr<uint64_t[]> batch { new uint64_t[g_batch_size] };
+    uint64_t batch_sz = 0;
+    uint64_t previous = 0;
+    while(true){
+        TraceSpan span_read { "parse", "scan-vertices" };
+        batch_sz = reader.read_vertices(batch.get(), g_batch_size);
+        if(batch_sz == 0) break;
+
+        for(uint64_t i = 0; i < batch_sz; i++){
+            uint64_t vertex_id = batch[i];
+            range.m_min = min(range.m_min, vertex_id);
+            range.m_max = max(range.m_max, vertex_id);
+            if(range.m_count > 0 && vertex_id <= previous){ range.m_sorted = false; }
+            previous = vertex_id;
+            range.m_count++;
+        }
+    }
+    reader.reset_vertices();
+
+    timer.stop();
+    stage->m_bytes_read = file_size(reader.get_path_vertex_list());
+    stage->m_num_vertices = range.m_count;
+    stage.close();
+    LOG("Input vertices scanned in " << timer << ", IDs in [" << range.m_min << ", " << range.m_max << "], dense: " << boolalpha << range.is_dense() << ", sorted: " << range.m_sorted);
+    return range;
+}
+
+VertexMapping::VertexMapping(GraphalyticsReader& reader, bool stable_order, DictionaryStatistics& stats) :
+        m_expected_num_vertices(stoull(reader.get_property("meta.vertices"))), m_stats(stats) {
+    m_range = scan_vertices(reader);
+
+    if(m_range.is_dense() && (m_range.m_sorted || !stable_order)){ // the IDs are [base, base + count), in the stable order if sorted
+        m_engine = Engine::OFFSET;
+    } else if(stable_order && m_range.m_sorted && m_range.is_bounded(s_rank_max_span)){ // the rank of the ID is the stable order
+        m_engine = Engine::RANK;
+        m_bitmap.reset(new RankBitmap(m_range.span()));
+    } else if(stable_order && m_range.m_sorted){ // the position in the sorted array is the stable order
+        m_engine = Engine::SEARCH;
+        m_index.reset(new LearnedIndex(m_range.m_count));
+    } else if(m_range.is_bounded(s_direct_max_span)){ // in the order of the vertex file or of first appearance
+        m_engine = Engine::DIRECT;
+        // the pages of an anonymous mapping are zeroed, that is, no vertex has been assigned yet
+        m_table = static_cast<uint64_t*>(map_memory(m_range.span() * sizeof(uint64_t)));
+    } else {
+        m_engine = Engine::DICTIONARY;
+        m_dictionary.reserve(m_expected_num_vertices);
+        m_stats.m_last_bucket_count = m_dictionary.bucket_count();
+    }
+    if(m_engine == Engine::OFFSET){
+        LOG("Vertex mapping: " << m_engine << (m_range.m_min == 0 ? " (identity)" : " (base " + to_string(m_range.m_min) + ")"));
+    } else {
+        LOG("Vertex mapping: " << m_engine);
+    }
+    g_report.set("vertex_mapping", to_string(m_engine));
+
+    if(m_engine == Engine::RANK){
+        build_bitmap(reader);
+    } else if(m_engine == Engine::SEARCH){
+        build_index(reader);
+    } else if(stable_order && m_engine != Engine::OFFSET){ // respect the same order of the vertices in the vertex file
+        parse_vertices(reader);
+    }
+}
+
+VertexMapping::~VertexMapping(){
+    if(m_table != nullptr){ unmap_memory(m_table, m_range.span() * sizeof(uint64_t)); }
+}
+
+void VertexMapping::parse_vertices(GraphalyticsReader& reader){
+    LOG("Reading the input vertices ...");
+    ReportStage stage { "read-vertices" };
+    common::Timer timer; timer.start();
+
+    unique_ptr<uint64_t[]> batch { new uint64_t[g_batch_size] };
+    uint64_t batch_sz = 0;
+    visit([&](auto& mapper){
+        while(true){
+            TraceSpan span_read { "parse", "read-vertices" };
+            batch_sz = reader.read_vertices(batch.get(), g_batch_size);
+            span_read.close();
+            if(batch_sz == 0) break;
+
+            TraceSpan span_remap { "remap", "insert-vertices" };
+            for(uint64_t i = 0; i < batch_sz; i++){ mapper(batch[i]); }
+        }
+    });
+
+    stage->m_bytes_read = file_size(reader.get_path_vertex_list());
+    stage->m_num_vertices = num_vertices();
+    if(m_engine == Engine::DICTIONARY){
+        stage->m_dictionary = m_stats;
+        stage->m_dictionary.analyse(m_dictionary);
+    }
+    stage.close();
+    LOG("Input vertices parsed in " << timer);
+    assert(num_vertices() == m_expected_num_vertices && "Cardinality mismatch");
+}
+
+void VertexMapping::build_bitmap(GraphalyticsReader& reader){
+    LOG("Reading the input vertices ...");
+    ReportStage stage { "read-vertices" };
+    common::Timer timer; timer.start();
+
+    unique_ptr<uint64_t[]> batch { new uint64_t[g_batch_size] };
+    uint64_t batch_sz = 0;
+    while(true){
+        TraceSpan span_read { "parse", "read-vertices" };
+        batch_sz = reader.read_vertices(batch.get(), g_batch_size);
+        span_read.close();
+        if(batch_sz == 0) break;
+
+        TraceSpan span_remap { "remap", "insert-vertices" };
+        for(uint64_t i = 0; i < batch_sz; i++){ m_bitmap->set(batch[i] - m_range.m_min); }
+    }
+    m_bitmap->build_directory();
+
+    stage->m_bytes_read = file_size(reader.get_path_vertex_list());
+    stage->m_num_vertices = num_vertices();
+    stage.close();
+    LOG("Input vertices parsed in " << timer << ", bitmap: " << to_string_bytes(m_bitmap->footprint()));
+    assert(m_bitmap->count() == m_range.m_count && "The IDs are sorted, hence unique");
+    assert(num_vertices() == m_expected_num_vertices && "Cardinality mismatch");
+}
+
+void VertexMapping::build_index(GraphalyticsReader& reader){
+    LOG("Reading the input vertices ...");
+    ReportStage stage { "read-vertices" };
+    common::Timer timer; timer.start();
+
+    unique_ptr<uint64_t[]> batch { new uint64_t[g_batch_size] };
+    uint64_t batch_sz = 0;
+    uint64_t position = 0;
+    while(true){
+        TraceSpan span_read { "parse", "read-vertices" };
+        batch_sz = reader.read_vertices(batch.get(), g_batch_size);
+        span_read.close();
+        if(batch_sz == 0) break;
+
+        TraceSpan span_remap { "remap", "insert-vertices" };
+        for(uint64_t i = 0; i < batch_sz; i++){ m_index->set(position++, batch[i]); }
+    }
+    assert(position == m_range.m_count && "The vertex file changed since the scan");
+    m_index->build();
+
+    stage->m_bytes_read = file_size(reader.get_path_vertex_list());
+    stage->m_num_vertices = num_vertices();
+    stage.close();
+    LOG("Input vertices parsed in " << timer << ", learned index: " << m_index->num_segments() << " segments, " << to_string_bytes(m_index->footprint()));
+    assert(num_vertices() == m_expected_num_vertices && "Cardinality mismatch");
+}
+
+void VertexMapping::finalise(GraphalyticsAlgorithms& algorithms){
+    // translate the IDs without inserting them
+    auto lookup = [this](uint64_t vertex_id) -> uint64_t {
+        switch(m_engine){
+        case Engine::DICTIONARY: {
+            auto it = m_dictionary.find(vertex_id);
+            assert(it != m_dictionary.end() && "The vertex does not exist");
+            return it->second;
+        }
+        case Engine::OFFSET:
+            return vertex_id - m_range.m_min;
+        case Engine::RANK:
+            assert(vertex_id - m_range.m_min < m_range.span() && m_bitmap->test(vertex_id - m_range.m_min) && "The vertex does not exist");
+            return m_bitmap->rank(vertex_id - m_range.m_min);
+        case Engine::SEARCH:
+            assert(m_index->find(vertex_id) != LearnedIndex::NOT_FOUND && "The vertex does not exist");
+            return m_index->find(vertex_id);
+        case Engine::DIRECT:
+            assert(vertex_id - m_range.m_min < m_range.span() && m_table[vertex_id - m_range.m_min] > 0 && "The vertex does not exist");
+            return m_table[vertex_id - m_range.m_min] -1;
+        }
+        return 0;
+    };
+
+    // Source for the BFS algorithm
+    if(algorithms.bfs.m_enabled){
+        algorithms.bfs.m_source_vertex = lookup( algorithms.bfs.m_source_vertex );
+    }
+
+    // Source for the SSSP algorithm
+    if(algorithms.sssp.m_enabled){
+        algorithms.sssp.m_source_vertex = lookup( algorithms.sssp.m_source_vertex );
+    }
+
+    if(m_engine == Engine::DICTIONARY){ m_stats.analyse(m_dictionary); }
+}
+
+void VertexMapping::log() const {
+    if(m_engine == Engine::DICTIONARY){
+        log_dictionary(m_stats, m_expected_num_vertices);
+    } else {
+        uint64_t footprint = 0;
+        if(m_engine == Engine::RANK){ footprint = m_bitmap->footprint(); }
+        else if(m_engine == Engine::SEARCH){ footprint = m_index->footprint(); }
+        else if(m_engine == Engine::DIRECT){ footprint = m_range.span() * sizeof(uint64_t); }
+        LOG("Vertex mapping: " << m_engine << ", vertices: " << num_vertices() << ", IDs in [" << m_range.m_min << ", " << m_range.m_max << "], memory: " << to_string_bytes(footprint) << ", no dictionary");
+    }
+}
+
+uint64_t VertexMapping::num_vertices() const {
+    switch(m_engine){
+    case Engine::OFFSET: case Engine::RANK: case Engine::SEARCH:
+        return m_range.m_count;
+    default:
+        return m_next_vertex_id;
+    }
+}
+
+string to_string(VertexMapping::Engine engine){
+    switch(engine){
+    case VertexMapping::Engine::DICTIONARY: return "dictionary";
+    case VertexMapping::Engine::OFFSET: return "offset";
+    case VertexMapping::Engine::RANK: return "rank";
+    case VertexMapping::Engine::SEARCH: return "search";
+    case VertexMapping::Engine::DIRECT: return "direct";
+    }
+    return "unknown";
+}
+
+ostream& operator<<(ostream& out, VertexMapping::Engine engine){
+    out << to_string(engine);
+    return out;
+}
@@ -0,0 +1,292 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "lib/common/error.hpp"
+#include "dictionary_statistics.hpp"
+#include "learned_index.hpp"
+#include "rank_bitmap.hpp"
+
+class GraphalyticsAlgorithms; // forward declaration
+class GraphalyticsReader; // forward declaration
+
+/**
+ * The IDs of the vertex file, from a scan of the file
+ */
+struct VertexRange {
+    uint64_t m_min = std::numeric_limits<uint64_t>::max(); // smallest vertex ID
+    uint64_t m_max = 0; // greatest vertex ID
+    uint64_t m_count = 0; // number of vertices
+    bool m_sorted = true; // whether the IDs are in strictly increasing order
+
+    // the number of IDs in [min, max]
+    uint64_t span() const { return m_count == 0 ? 0 : m_max - m_min +1; }
+
+    // whether the IDs are contiguous, [min, min + count)
+    bool is_dense() const { return m_count > 0 && span() == m_count; }
+
+    // whether the span of the IDs is at most `factor' times the number of vertices
+    bool is_bounded(uint64_t factor) const { return m_count > 0 && (m_max - m_min) / factor < m_count; }
+};
+
+/**
+ * Read the whole vertex file and determine the range of its IDs. The position of the vertex file is reset at the end.
+ */
+VertexRange scan_vertices(GraphalyticsReader& reader);
+
+/**
+ * A mapper translates a vertex ID of the input graph into the dense domain [0, num_vertices), assigning a new ID when
+ * the vertex is seen for the first time, if the order of the mapping is not fixed in advance. The mappers that assign
+ * new IDs also provide lookup(vertex_id), which does not assign anything and can be invoked concurrently, returning
+ * g_vertex_not_found for a vertex without an ID yet.
+ */
+constexpr uint64_t g_vertex_not_found = std::numeric_limits<uint64_t>::max();
+
+// Hash table, for arbitrary IDs
+class DictionaryMapper {
+    VertexDictionary& m_vertices; // the mapping
+    uint64_t& m_next_vertex_id; // the ID of the next vertex inserted
+    DictionaryStatistics& m_stats; // counters of the operations
+
+public:
+    DictionaryMapper(VertexDictionary& vertices, uint64_t& next_vertex_id, DictionaryStatistics& stats) :
+        m_vertices(vertices), m_next_vertex_id(next_vertex_id), m_stats(stats) { }
+
+    uint64_t operator()(uint64_t vertex_id){
+        // unlike insert, try_emplace does not allocate a node when the vertex already exists
+        auto it = m_vertices.try_emplace(vertex_id, m_next_vertex_id);
+        m_stats.m_num_lookups++;
+        if(it.second){ // new vertex
+            m_next_vertex_id++;
+            m_stats.m_num_inserts++;
+            m_stats.on_insert(m_vertices.bucket_count());
+        }
+        return it.first->second;
+    }
+
+    uint64_t lookup(uint64_t vertex_id) const {
+        auto it = m_vertices.find(vertex_id);
+        return it != m_vertices.end() ? it->second : g_vertex_not_found;
+    }
+
+    // account the invocations of lookup() in the statistics, as they are not recorded by lookup() itself
+    void record_lookups(uint64_t count){ m_stats.m_num_lookups += count; }
+};
+
+// The IDs have already been translated
+class IdentityMapper {
+public:
+    uint64_t operator()(uint64_t vertex_id) const { return vertex_id; }
+};
+
+// Contiguous IDs already in the order of the mapping, [base, base + num_vertices) -> [0, num_vertices)
+class OffsetMapper {
+    const uint64_t m_base; // the smallest ID
+    const uint64_t m_num_vertices; // size of the range
+
+public:
+    OffsetMapper(uint64_t base, uint64_t num_vertices) : m_base(base), m_num_vertices(num_vertices) { }
+
+    uint64_t operator()(uint64_t vertex_id) const {
+        uint64_t result = vertex_id - m_base; // wraps around for vertex_id < m_base
+        if(result >= m_num_vertices) ERROR("The vertex " << vertex_id << " does not belong to the vertex file");
+        return result;
+    }
+};
+
+// Sorted IDs in the range [base, base + span), the new ID is the rank of the ID in the bitmap of the IDs present
+class RankMapper {
+    const RankBitmap& m_bitmap; // the IDs present, offset by base
+    const uint64_t m_base; // the smallest ID
+
+public:
+    RankMapper(const RankBitmap& bitmap, uint64_t base) : m_bitmap(bitmap), m_base(base) { }
+
+    uint64_t operator()(uint64_t vertex_id) const {
+        uint64_t index = vertex_id - m_base; // wraps around for vertex_id < m_base
+        if(index >= m_bitmap.size() || !m_bitmap.test(index)) ERROR("The vertex " << vertex_id << " does not belong to the vertex file");
+        return m_bitmap.rank(index);
+    }
+};
+
+// Sorted IDs of arbitrary range, the new ID is the position of the ID in the sorted array, found with a learned index.
+// The mapper is pure, the IDs can be translated in batch
+class SearchMapper {
+    const LearnedIndex& m_index; // the sorted IDs
+
+public:
+    SearchMapper(const LearnedIndex& index) : m_index(index) { }
+
+    uint64_t operator()(uint64_t vertex_id) const {
+        uint64_t result = m_index.find(vertex_id);
+        if(result == LearnedIndex::NOT_FOUND) ERROR("The vertex " << vertex_id << " does not belong to the vertex file");
+        return result;
+    }
+
+    void translate(const uint64_t* vertex_ids, uint64_t* output, uint64_t num_vertices) const {
+        m_index.find(vertex_ids, output, num_vertices);
+        for(uint64_t i = 0; i < num_vertices; i++){
+            if(output[i] == LearnedIndex::NOT_FOUND) ERROR("The vertex " << vertex_ids[i] << " does not belong to the vertex file");
+        }
+    }
+};
+
+// Direct address table over the range [base, base + span), storing the new ID + 1 of each vertex, 0 if not assigned yet
+class DirectMapper {
+    uint64_t* const m_table; // the mapping
+    const uint64_t m_base; // the smallest ID
+    const uint64_t m_span; // size of the table
+    uint64_t& m_next_vertex_id; // the ID of the next vertex seen for the first time
+
+public:
+    DirectMapper(uint64_t* table, uint64_t base, uint64_t span, uint64_t& next_vertex_id) :
+        m_table(table), m_base(base), m_span(span), m_next_vertex_id(next_vertex_id) { }
+
+    uint64_t operator()(uint64_t vertex_id){
+        uint64_t index = vertex_id - m_base;
+        if(index >= m_span) ERROR("The vertex " << vertex_id << " does not belong to the vertex file");
+        uint64_t& slot = m_table[index];
+        if(slot == 0){ slot = ++m_next_vertex_id; } // first time the vertex is seen
+        return slot -1;
+    }
+
+    uint64_t lookup(uint64_t vertex_id) const {
+        uint64_t index = vertex_id - m_base;
+        if(index >= m_span) ERROR("The vertex " << vertex_id << " does not belong to the vertex file");
+        return m_table[index] > 0 ? m_table[index] -1 : g_vertex_not_found;
+    }
+};
+
+/**
+ * Whether the mapper translates the IDs in batch, with a method translate(const uint64_t* vertex_ids, uint64_t* output,
+ * uint64_t num_vertices). Only pure mappers, which do not assign new IDs, can reorder their lookups in this way.
+ */
+template<typename Mapper, typename = void>
+constexpr bool is_batch_mapper = false;
+template<typename Mapper>
+constexpr bool is_batch_mapper<Mapper, std::void_t<decltype(&Mapper::translate)>> = true;
+
+/**
+ * Whether the mapper only looks up the IDs, without assigning new ones: its operator() is const and it can be invoked
+ * by multiple threads concurrently, in any order
+ */
+template<typename Mapper>
+constexpr bool is_pure_mapper = std::is_invocable_v<const Mapper&, uint64_t>;
+
+/**
+ * The mapping of the vertex IDs into the dense domain [0, num_vertices). The vertex file is scanned first, to pick
+ * the cheapest engine that yields the requested order, either the order of the vertex file (stable order) or any
+ * order, by default the order the vertices first appear in the edge file:
+ * - OFFSET: the IDs are contiguous, [base, base + count), and, in stable order, sorted. The new ID is the offset from
+ *   the smallest ID, the identity when the base is 0, and no memory is required;
+ * - RANK: in stable order, the IDs are sorted and their span is at most s_rank_max_span times the number of vertices.
+ *   A bitmap marks the IDs present and the new ID is the rank of the ID, 0.16 bytes per ID in the span;
+ * - SEARCH: in stable order, the IDs are sorted. The new ID is the position of the ID in the sorted array of the IDs,
+ *   found with a learned index, about 8 bytes per vertex;
+ * - DIRECT: the span of the IDs is at most s_direct_max_span times the number of vertices, and in stable order they
+ *   are not sorted. A table indexed by the offset of the ID stores the new ID, assigned in the same order of the
+ *   DICTIONARY, 8 bytes per ID in the span;
+ * - DICTIONARY: the hash table VertexDictionary, for arbitrary IDs.
+ */
+class VertexMapping {
+public:
+    enum class Engine { DICTIONARY, OFFSET, RANK, SEARCH, DIRECT };
+
+    static constexpr uint64_t s_rank_max_span = 64; // max ratio between the span of the IDs and the vertices, engine RANK
+    static constexpr uint64_t s_direct_max_span = 4; // max ratio between the span of the IDs and the vertices, engine DIRECT
+
+private:
+    VertexMapping(const VertexMapping&) = delete;
+    VertexMapping& operator=(const VertexMapping&) = delete;
+
+    Engine m_engine = Engine::DICTIONARY; // the engine selected
+    VertexRange m_range; // the IDs of the vertex file
+    const uint64_t m_expected_num_vertices; // the property meta.vertices
+    DictionaryStatistics& m_stats; // statistics on the dictionary, for the engine DICTIONARY
+    uint64_t m_next_vertex_id = 0; // the ID of the next vertex seen for the first time
+    VertexDictionary m_dictionary; // engine DICTIONARY
+    std::unique_ptr<RankBitmap> m_bitmap; // engine RANK
+    std::unique_ptr<LearnedIndex> m_index; // engine SEARCH
+    uint64_t* m_table = nullptr; // engine DIRECT
+
+    // read the vertex file and assign the IDs in the same order
+    void parse_vertices(GraphalyticsReader& reader);
+
+    // read the vertex file and mark the IDs present in the bitmap, engine RANK
+    void build_bitmap(GraphalyticsReader& reader);
+
+    // read the vertex file into the sorted array of the learned index, engine SEARCH
+    void build_index(GraphalyticsReader& reader);
+
+public:
+    /**
+     * Scan the vertex file and select the engine. In stable order, the vertices of the vertex file are also
+     * inserted in the mapping. The statistics of the dictionary are recorded in `stats'. Only the vertex file of the
+     * reader is accessed, another thread can read the edge file concurrently.
+     */
+    VertexMapping(GraphalyticsReader& reader, bool stable_order, DictionaryStatistics& stats);
+
+    /**
+     * Release the memory of the mapping
+     */
+    ~VertexMapping();
+
+    /**
+     * Invoke fn(mapper), with the mapper of the selected engine
+     */
+    template<typename Fn>
+    void visit(Fn&& fn){
+        switch(m_engine){
+        case Engine::DICTIONARY: { DictionaryMapper mapper { m_dictionary, m_next_vertex_id, m_stats }; fn(mapper); } break;
+        case Engine::OFFSET: { OffsetMapper mapper { m_range.m_min, m_range.m_count }; fn(mapper); } break;
+        case Engine::RANK: { RankMapper mapper { *m_bitmap, m_range.m_min }; fn(mapper); } break;
+        case Engine::SEARCH: { SearchMapper mapper { *m_index }; fn(mapper); } break;
+        case Engine::DIRECT: { DirectMapper mapper { m_table, m_range.m_min, m_range.span(), m_next_vertex_id }; fn(mapper); } break;
+        }
+    }
+
+    /**
+     * Once all edges have been remapped, translate the source vertices of the algorithms and analyse the dictionary
+     */
+    void finalise(GraphalyticsAlgorithms& algorithms);
+
+    /**
+     * Log the statistics of the dictionary or, for the other engines, the range of the IDs
+     */
+    void log() const;
+
+    /**
+     * The number of vertices mapped so far
+     */
+    uint64_t num_vertices() const;
+
+    /**
+     * The engine selected
+     */
+    Engine engine() const { return m_engine; }
+};
+
+std::string to_string(VertexMapping::Engine engine);
+std::ostream& operator<<(std::ostream& out, VertexMapping::Engine engine);
@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "weight.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "lib/common/error.hpp"
+
+using namespace std;
+
+/*****************************************************************************
+ *                                                                           *
+ *  Weight type                                                              *
+ *                                                                           *
+ *****************************************************************************/
+
+WeightType weight_type_from_string(const string& name){
+    string value = name;
+    transform(value.begin(), value.end(), value.begin(), ::tolower);
+    if(value == "real" || value == "double" || value == "float64"){
+        return WeightType::FLOAT64;
+    } else if (value == "float" || value == "float32"){
+        return WeightType::FLOAT32;
+    } else if (value == "fixed16"){
+        return WeightType::FIXED16;
+    } else if (value == "fixed24"){
+        return WeightType::FIXED24;
+    } else {
+        INVALID_ARGUMENT("Invalid weight type: `" << name << "'. Expected one of: double, float, fixed16 or fixed24");
+    }
+}
+
+string to_string(WeightType type){
+    switch(type){
+    case WeightType::FLOAT64: return "real";
+    case WeightType::FLOAT32: return "float32";
+    case WeightType::FIXED16: return "fixed16";
+    case WeightType::FIXED24: return "fixed24";
+    default: return "unknown";
+    }
+}
+
+ostream& operator<<(ostream& out, WeightType type){
+    out << to_string(type);
+    return out;
+}
+
+bool is_compact(WeightType type){
+    return type != WeightType::FLOAT64;
+}
+
+void validate_weight_range(WeightType type, double min_weight, double max_weight){
+    if((type == WeightType::FIXED16 || type == WeightType::FIXED24) && min_weight < 0){
+        INVALID_ARGUMENT("The weights of the graph, in [" << min_weight << ", " << max_weight << "], cannot be represented in " << type << ", "
+                "which only holds the weights in [0, max weight]. Use --weights double or float");
+    }
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  Encoder                                                                  *
+ *                                                                           *
+ *****************************************************************************/
+
+static uint64_t max_code(WeightType type){
+    switch(type){
+    case WeightType::FIXED16: return (1ull << 16) -1;
+    case WeightType::FIXED24: return (1ull << 24) -1;
+    default: return 0;
+    }
+}
+
+static double get_scale(WeightType type, double max_weight){
+    if(max_code(type) == 0 || max_weight <= 0) return 1.0;
+    return max_weight / max_code(type);
+}
+
+WeightEncoder::WeightEncoder(WeightType type, double max_weight) : m_type(type), m_scale(get_scale(type, max_weight)), m_max_code(max_code(type)) {
+
+}
+
+WeightType WeightEncoder::type() const {
+    return m_type;
+}
+
+double WeightEncoder::scale() const {
+    return m_scale;
+}
+
+uint64_t WeightEncoder::width() const {
+    switch(m_type){
+    case WeightType::FLOAT64: return sizeof(double);
+    case WeightType::FLOAT32: return sizeof(float);
+    case WeightType::FIXED16: return 2;
+    case WeightType::FIXED24: return 3;
+    default: assert(0 && "Invalid type"); return 0;
+    }
+}
+
+void WeightEncoder::print(ostream& out, double weight){
+    switch(m_type){
+    case WeightType::FLOAT64: {
+        out << weight;
+    } break;
+    case WeightType::FLOAT32: {
+        float value = weight;
+        record_error(weight, value);
+        out << value;
+    } break;
+    case WeightType::FIXED16:
+    case WeightType::FIXED24: {
+        uint64_t code = to_code(weight);
+        record_error(weight, code * m_scale);
+        out << code;
+    } break;
+    }
+}
+
+double WeightEncoder::max_error() const {
+    return m_max_error;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *  Generator                                                                *
+ *                                                                           *
+ *****************************************************************************/
+
+WeightGenerator::WeightGenerator(uint64_t seed) : m_random(seed) {
+
+}
+
+void WeightGenerator::set_max_weight(double value){
+    if(value <= 0) INVALID_ARGUMENT("Expected a positive value: " << value);
+    m_max_weight = value;
+}
+
+void WeightGenerator::set_symmetric(bool value){
+    m_symmetric = value;
+}
+
+void WeightGenerator::generate(const uint64_t* __restrict sources, const uint64_t* __restrict destinations, double* __restrict out_weights, uint64_t num_edges) const {
+    const double multiplier = m_max_weight / (1ull << 53);
+
+    // keep the loops free of branches, so that the compiler can vectorise them
+    if(m_symmetric){
+        for(uint64_t i = 0; i < num_edges; i++){
+            uint64_t u = min(sources[i], destinations[i]);
+            uint64_t v = max(sources[i], destinations[i]);
+            out_weights[i] = ((m_random(u, v) >> 11) +1) * multiplier;
+        }
+    } else {
+        for(uint64_t i = 0; i < num_edges; i++){
+            out_weights[i] = ((m_random(sources[i], destinations[i]) >> 11) +1) * multiplier;
+        }
+    }
+}
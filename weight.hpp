@@ -0,0 +1,181 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "lib/common/error.hpp"
+#include "random.hpp"
+
+/**
+ * The representation of the edge weights, both in memory and in the output files
+ */
+enum class WeightType {
+    FLOAT64, // double precision, the default
+    FLOAT32, // single precision
+    FIXED16, // 16-bit fixed point, the weight is stored as an integer code, weight = code * scale
+    FIXED24, // 24-bit fixed point, the weight is stored as an integer code, weight = code * scale
+};
+
+/**
+ * Retrieve the weight type from its name: real/double, float/float32, fixed16 or fixed24
+ */
+WeightType weight_type_from_string(const std::string& name);
+
+/**
+ * Name of the weight type, as recorded in the property file
+ */
+std::string to_string(WeightType type);
+std::ostream& operator<<(std::ostream& out, WeightType type);
+
+/**
+ * Check whether the weights can be stored in single precision in memory
+ */
+bool is_compact(WeightType type);
+
+/**
+ * Check that all weights of the graph, in [min_weight, max_weight], can be represented in the given type, otherwise
+ * raise an INVALID_ARGUMENT. The fixed point representations only hold the weights in [0, max_weight].
+ */
+void validate_weight_range(WeightType type, double min_weight, double max_weight);
+
+/**
+ * Serialise the weights in the given representation and keep track of the quantization error introduced
+ */
+class WeightEncoder {
+    const WeightType m_type; // the target representation
+    const double m_scale; // fixed point only, the value of the unit code
+    const uint64_t m_max_code; // fixed point only, the greatest code that can be represented
+    double m_max_error = 0; // the max absolute difference observed between the original & the encoded weights
+
+    // Round the weight to the closest code, the weights outside [0, max_code * scale] cannot be represented
+    uint64_t to_code(double weight) const {
+        double code = std::round(weight / m_scale);
+        if(!(code >= 0 && code <= m_max_code)){ // also NaN
+            INVALID_ARGUMENT("The weight " << weight << " cannot be represented in " << m_type << ", valid range: [0, " << m_max_code * m_scale << "]");
+        }
+        return static_cast<uint64_t>(code);
+    }
+
+public:
+    /**
+     * Initialise the encoder. The argument max_weight is the greatest weight that needs to be encoded, it determines
+     * the scale for the fixed point representations
+     */
+    WeightEncoder(WeightType type, double max_weight);
+
+    /**
+     * The representation of the encoder
+     */
+    WeightType type() const;
+
+    /**
+     * The multiplier for the fixed point codes, or 1.0 for the floating point representations
+     */
+    double scale() const;
+
+    /**
+     * The number of bytes required to store a single weight in binary form
+     */
+    uint64_t width() const;
+
+    /**
+     * Store the given weight in binary form in the buffer `out', of at least width() bytes
+     */
+    void encode(double weight, char* out){
+        switch(m_type){
+        case WeightType::FLOAT64: {
+            memcpy(out, &weight, sizeof(double));
+        } break;
+        case WeightType::FLOAT32: {
+            float value = weight;
+            record_error(weight, value);
+            memcpy(out, &value, sizeof(float));
+        } break;
+        case WeightType::FIXED16:
+        case WeightType::FIXED24: {
+            uint64_t code = to_code(weight);
+            record_error(weight, code * m_scale);
+            for(int i = 0, sz = (m_type == WeightType::FIXED16 ? 2 : 3); i < sz; i++){ out[i] = static_cast<char>(code >> (8 * i)); } // little endian
+        } break;
+        }
+    }
+
+    /**
+     * Print the given weight in text form
+     */
+    void print(std::ostream& out, double weight);
+
+    /**
+     * Record the error of rounding the weight from the original value to the one stored in memory
+     */
+    void record_error(double original, double stored){
+        m_max_error = std::max(m_max_error, std::fabs(original - stored));
+    }
+
+    /**
+     * The max absolute quantization error observed so far
+     */
+    double max_error() const;
+};
+
+/**
+ * Synthesise the weights for the edges of an unweighted graph. The weight of an edge is a pure function of the seed
+ * and of its endpoints: the same edge always obtains the same weight, regardless of the order the edges are read and
+ * of the thread generating it.
+ */
+class WeightGenerator {
+    Philox4x32 m_random; // counter-based generator, the counter is the pair (source, destination)
+    double m_max_weight = 1.0; // the weights are generated in the interval (0, max_weight]
+    bool m_symmetric = false; // whether the edges u -> v and v -> u should obtain the same weight, for undirected graphs
+
+public:
+    /**
+     * Initialise the generator with the given seed
+     */
+    WeightGenerator(uint64_t seed);
+
+    /**
+     * Set the max weight that can be generated
+     */
+    void set_max_weight(double value);
+
+    /**
+     * Shall the edges u -> v and v -> u obtain the same weight
+     */
+    void set_symmetric(bool value);
+
+    /**
+     * Generate the weight for the edge source -> destination
+     */
+    double operator()(uint64_t source, uint64_t destination) const {
+        if(m_symmetric && source > destination) std::swap(source, destination);
+        uint64_t bits = m_random(source, destination) >> 11; // 53 bits, the precision of a double
+        return (bits +1) * (m_max_weight / (1ull << 53)); // in (0, max_weight]
+    }
+
+    /**
+     * Generate the weights for a batch of edges
+     */
+    void generate(const uint64_t* sources, const uint64_t* destinations, double* out_weights, uint64_t num_edges) const;
+};
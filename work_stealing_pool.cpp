@@ -0,0 +1,135 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "work_stealing_pool.hpp"
+
+#include "perf_counters.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+// the pool and the id of the worker running in the current thread, if any
+static thread_local WorkStealingPool* g_current_pool = nullptr;
+static thread_local uint64_t g_current_worker = 0;
+
+WorkStealingPool::WorkStealingPool(uint64_t num_threads, const string& name){
+    num_threads = max<uint64_t>(num_threads, 1);
+    for(uint64_t i = 0; i < num_threads; i++){ m_workers.emplace_back(new Worker()); }
+    for(uint64_t i = 0; i < num_threads; i++){
+        m_threads.emplace_back(&WorkStealingPool::main_thread, this, i, name + "-" + to_string(i));
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    {
+        scoped_lock<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv_work.notify_all();
+    for(auto& thread : m_threads){ thread.join(); }
+}
+
+void WorkStealingPool::submit(Task task){
+    uint64_t worker_id = 0;
+    {
+        scoped_lock<mutex> lock(m_mutex);
+        m_num_pending++; // before the task becomes visible, a worker may already complete it in the meanwhile
+        if(g_current_pool == this){
+            worker_id = g_current_worker;
+        } else {
+            worker_id = m_next_worker;
+            m_next_worker = (m_next_worker +1) % m_workers.size();
+        }
+    }
+
+    {
+        scoped_lock<mutex> lock(m_workers[worker_id]->m_mutex);
+        m_workers[worker_id]->m_tasks.push_back(move(task));
+    }
+
+    {
+        // increment the counter while holding the lock, the idle workers check it before waiting
+        scoped_lock<mutex> lock(m_mutex);
+        m_num_queued++;
+    }
+    m_cv_work.notify_one();
+}
+
+bool WorkStealingPool::next_task(uint64_t worker_id, Task& task){
+    { // own deque, newest task
+        Worker* worker = m_workers[worker_id].get();
+        scoped_lock<mutex> lock(worker->m_mutex);
+        if(!worker->m_tasks.empty()){
+            task = move(worker->m_tasks.back());
+            worker->m_tasks.pop_back();
+            m_num_queued--;
+            return true;
+        }
+    }
+
+    // steal the oldest task of another worker
+    for(uint64_t i = 1; i < m_workers.size(); i++){
+        Worker* victim = m_workers[(worker_id + i) % m_workers.size()].get();
+        scoped_lock<mutex> lock(victim->m_mutex);
+        if(!victim->m_tasks.empty()){
+            task = move(victim->m_tasks.front());
+            victim->m_tasks.pop_front();
+            m_num_queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingPool::main_thread(uint64_t worker_id, const string& name){
+    g_current_pool = this;
+    g_current_worker = worker_id;
+    g_tracer.set_thread_name(name);
+    g_perf.set_thread_name(name);
+
+    while(true){
+        Task task;
+        if(next_task(worker_id, task)){
+            try {
+                task();
+            } catch(...) {
+                scoped_lock<mutex> lock(m_mutex);
+                if(!m_error){ m_error = current_exception(); } // only retain the first error
+            }
+
+            task = nullptr; // release the captured state before signalling the completion
+            scoped_lock<mutex> lock(m_mutex);
+            m_num_pending--;
+            if(m_num_pending == 0){ m_cv_done.notify_all(); }
+        } else {
+            unique_lock<mutex> lock(m_mutex);
+            m_cv_work.wait(lock, [this](){ return m_stop || m_num_queued > 0; });
+            if(m_stop) return;
+        }
+    }
+}
+
+void WorkStealingPool::wait(){
+    unique_lock<mutex> lock(m_mutex);
+    m_cv_done.wait(lock, [this](){ return m_num_pending == 0; });
+    if(m_error){
+        exception_ptr error = m_error;
+        m_error = nullptr;
+        rethrow_exception(error);
+    }
+}
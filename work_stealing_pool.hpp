@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2019 Dean De Leo, email: dleo[at]cwi.nl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A pool of threads executing tasks that can spawn further tasks, e.g. the partitions of a recursive sort. Each
+ * worker has its own deque: it pushes and pops its own tasks at the back, in LIFO order, to keep working on the data
+ * still in its cache, and once its deque is empty it steals the oldest task, the largest in a recursive
+ * decomposition, from the front of the deque of another worker.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    struct Worker {
+        std::mutex m_mutex; // protect the deque
+        std::deque<Task> m_tasks; // tasks of the worker, owner at the back, thieves at the front
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers; // the deque of each thread
+    std::vector<std::thread> m_threads; // the threads of the pool
+    std::mutex m_mutex; // sync the idle workers and wait()
+    std::condition_variable m_cv_work; // wake up the idle workers
+    std::condition_variable m_cv_done; // all tasks have been executed
+    std::atomic<int64_t> m_num_queued = 0; // number of tasks in the deques, transiently negative when a task is popped before being counted
+    uint64_t m_num_pending = 0; // number of tasks submitted and not yet completed, protected by m_mutex
+    uint64_t m_next_worker = 0; // round robin assignment of the tasks submitted from outside the pool
+    std::exception_ptr m_error; // the first exception raised by a task
+    bool m_stop = false; // terminate the workers
+
+    // the main loop of a worker
+    void main_thread(uint64_t worker_id, const std::string& name);
+
+    // fetch a task, from the deque of the worker or stolen from another worker
+    bool next_task(uint64_t worker_id, Task& task);
+
+public:
+    /**
+     * Start `num_threads' workers, named <name>-<id> in the trace and in the performance counters
+     */
+    WorkStealingPool(uint64_t num_threads, const std::string& name);
+
+    /**
+     * Stop the workers. The tasks not yet executed are discarded.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * Submit a task. When invoked by a worker, the task is pushed to its own deque, otherwise to the next worker in
+     * a round robin order.
+     */
+    void submit(Task task);
+
+    /**
+     * Wait for all tasks submitted to complete, including those spawned in the meanwhile by other tasks. Rethrow the
+     * first exception raised by a task, if any.
+     */
+    void wait();
+
+    /**
+     * Number of workers
+     */
+    uint64_t num_threads() const { return m_threads.size(); }
+};